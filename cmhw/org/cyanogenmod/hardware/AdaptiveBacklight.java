@@ -16,36 +16,34 @@
 
 package org.cyanogenmod.hardware;
 
-import org.cyanogenmod.hardware.util.FileUtils;
+import android.os.SystemProperties;
 
 /**
  * NVIDIA SmartDimmer adaptive backlight implementation
  *
+ * The lights HAL owns the SmartDimmer nodes and switches them with the
+ * backlight level and power profile; this only sets whether the user
+ * allows it, which the HAL applies as soon as the property changes.
+ * The node itself follows the backlight level and profile, so the user
+ * setting is read back from the property rather than from the node.
+ *
  * {@link frameworks/opt/hardware/src/org/cyanogenmod/hardware/AdaptiveBacklight.java}
  */
 public class AdaptiveBacklight {
 
-    private static final String SMARTDIMMER_SYSFS =
-            "/sys/class/graphics/fb0/device/smartdimmer/enable";
+    private static final String SMARTDIMMER_PROP = "persist.sys.smartdimmer";
 
     public static boolean isSupported() {
         return true;
     }
 
     public static boolean isEnabled() {
-        try {
-            String value = FileUtils.readOneLine(SMARTDIMMER_SYSFS);
-            if (value == null) {
-                return false;
-            }
-            return Integer.parseInt(value) == 1;
-        } catch (NumberFormatException nfex) {
-            return false;
-        }
+        return SystemProperties.getBoolean(SMARTDIMMER_PROP, true);
     }
 
     public static boolean setEnabled(boolean status) {
-        return FileUtils.writeLine(SMARTDIMMER_SYSFS, status ? "1" : "0");
+        SystemProperties.set(SMARTDIMMER_PROP, status ? "1" : "0");
+        return true;
     }
 
 }
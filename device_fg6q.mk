@@ -60,7 +60,9 @@ PRODUCT_PACKAGES += \
 
 # Power
 PRODUCT_COPY_FILES += \
-    device/quanta/fg6q/power.macallan.rc:system/etc/power.macallan.rc
+    device/quanta/fg6q/power.macallan.rc:system/etc/power.macallan.rc \
+    device/quanta/fg6q/power/power_thermal.conf:system/etc/power_thermal.conf \
+    device/quanta/fg6q/power/power_tunables.conf:system/etc/power_tunables.conf
 
 # Camera
 PRODUCT_COPY_FILES += \
@@ -18,39 +18,298 @@
 #define LOG_TAG "lights"
 
 #include <cutils/log.h>
+#include <cutils/properties.h>
 
+#include <limits.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 
+#include <poll.h>
+#include <time.h>
+
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 
 #include <hardware/lights.h>
 #include <hardware/hardware.h>
 
-static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+#ifdef __BIONIC__
+#define _REALLY_INCLUDE_SYS__SYSTEM_PROPERTIES_H_
+#include <sys/_system_properties.h>
+#endif
+
+/*
+ * Optional prefix for every sysfs path, taken from the environment so the
+ * module can be driven against a fake tree off-device.
+ */
+#define SYSFS_ROOT_ENV "MACALLAN_SYSFS_ROOT"
+
+static pthread_once_t g_sysfs_root_once = PTHREAD_ONCE_INIT;
+static char const *g_sysfs_root = "";
 
-static int write_int(char const *path, int value)
+static void init_sysfs_root(void)
 {
+    char const *root = getenv(SYSFS_ROOT_ENV);
+
+    if (root && root[0])
+        g_sysfs_root = root;
+}
+
+static char const *sysfs_path(char const *path, char *buf, size_t size)
+{
+    pthread_once(&g_sysfs_root_once, init_sysfs_root);
+
+    if (!g_sysfs_root[0])
+        return path;
+
+    snprintf(buf, size, "%s%s", g_sysfs_root, path);
+    return buf;
+}
+
+#define BACKLIGHT_PATH "/sys/class/backlight/pwm-backlight/brightness"
+
+/*
+ * A backlight request with LIGHT_FLASH_TIMED ramps to the new level over
+ * flashOnMS instead of stepping, so a fade is one call rather than dozens
+ * from the framework. Ramps are interpolated on a square root scale,
+ * close enough to perceived lightness that the fade looks even, and
+ * stepped at the panel refresh rate.
+ *
+ * Nothing uses this yet: the stock LightsService never sends a flash mode
+ * for LIGHT_ID_BACKLIGHT, so it needs a framework change to request the
+ * ramp. Until then every backlight request is applied as a step.
+ */
+#define RAMP_STEP_MS 16
+#define RAMP_MAX_MS 10000
+/* Perceptual scale: level = 255 * (p / PERCEPTUAL_MAX)^2 */
+#define PERCEPTUAL_MAX 4096
+#define MAX_LEVEL 255
+
+#define NSEC_PER_MSEC 1000000LL
+
+/*
+ * SmartDimmer lowers the backlight and compensates in the pixels, which
+ * saves the most panel power at high brightness and shows up as banding
+ * at low brightness. The panel and profile dependent settings come from
+ * power.macallan.rc through the power HAL as properties; the user toggle
+ * from AdaptiveBacklight. Below SD_MIN_LEVEL SmartDimmer is turned off,
+ * and up to SD_FULL_LEVEL it runs one step milder than configured.
+ *
+ * The properties are cached rather than read on every level change. A
+ * watcher thread reloads them when any property changes and has the
+ * current level re-evaluated, so a profile switch or the user toggle
+ * takes effect straight away.
+ */
+#define SMARTDIMMER_ENABLE_PATH "/sys/class/graphics/fb0/device/smartdimmer/enable"
+#define SMARTDIMMER_AGGRESSIVENESS_PATH \
+        "/sys/class/graphics/fb0/device/smartdimmer/aggressiveness"
+#define SD_ENABLE_PROP "persist.sys.SD_ENABLE"
+#define SD_AGGRESSIVENESS_PROP "persist.sys.SD_AGGRESSIVENESS"
+#define SD_USER_PROP "persist.sys.smartdimmer"
+#define SD_MIN_LEVEL 48
+#define SD_FULL_LEVEL 160
+#define SD_MILD_STEP 2
+
+/* A sysfs node kept open and only written when its value changes. */
+struct cached_node {
+    const char *path;
     int fd;
-    static int already_warned = -1;
-    fd = open(path, O_RDWR);
-    if (fd >= 0) {
-        char buffer[20];
-        int bytes = sprintf(buffer, "%d\n", value);
-        int amt = write(fd, buffer, bytes);
-        close(fd);
-        return amt == -1 ? -errno : 0;
-    } else {
-        if (already_warned == -1) {
-            ALOGE("write_int failed to open %s\n", path);
-            already_warned = 1;
-        }
-        return -errno;
+    /* Value last written, -1 if none yet. */
+    int value;
+    int warned;
+};
+
+/*
+ * Auto-brightness and slider drags send bursts of set_light calls, so the
+ * brightness and SmartDimmer nodes are kept open for the life of the
+ * device and only written when their value changes. A write can stall
+ * behind the PWM driver, so it is done by a writer thread: callers drop
+ * the level into a single-slot mailbox and return, and the thread only
+ * ever applies the newest level, dropping any that were replaced while
+ * it was writing.
+ */
+struct backlight_device_t {
+    struct light_device_t dev;
+    /* Only touched by the writer, or under lock without one. */
+    struct cached_node brightness;
+    struct cached_node sd_enable;
+    struct cached_node sd_aggressiveness;
+    /*
+     * Request waiting for the writer, -1 when empty. A request is the
+     * level in the low 16 bits and the ramp time in ms above them.
+     */
+    atomic_llong mailbox;
+    /* Request last handed over, so repeats cost a single load. */
+    atomic_llong requested;
+    /* eventfd the writer sleeps on; -1 if there is no writer thread. */
+    int wake_fd;
+    /* Ramp timer and state, only touched by the writer. */
+    int ramp_fd;
+    int ramp_from;
+    int ramp_to;
+    int64_t ramp_start_ns;
+    int64_t ramp_end_ns;
+    atomic_bool stop;
+    pthread_t writer;
+    /* Serialises inline writes when the writer could not be started. */
+    pthread_mutex_t lock;
+    /* Set when the SmartDimmer properties changed under the writer. */
+    atomic_bool sd_dirty;
+};
+
+/* Cached SmartDimmer properties, shared by every device. */
+static atomic_int sd_enable_prop;
+static atomic_int sd_aggressiveness_prop;
+static atomic_int sd_user_prop;
+
+/* Device told about property changes, guarded by sd_listener_lock. */
+static struct backlight_device_t *sd_listener;
+static pthread_mutex_t sd_listener_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t sd_watch_once = PTHREAD_ONCE_INIT;
+
+static int open_node(struct cached_node *node)
+{
+    char real_path[PATH_MAX];
+    int fd = open(sysfs_path(node->path, real_path, sizeof(real_path)),
+            O_WRONLY | O_CLOEXEC);
+
+    if (fd < 0 && !node->warned) {
+        ALOGE("failed to open %s\n", node->path);
+        node->warned = 1;
     }
+
+    return fd;
+}
+
+/* Format value followed by a newline, returning the length. */
+static int format_int(char *buffer, size_t size, int value)
+{
+    char tmp[12];
+    unsigned int v = value < 0 ? -(unsigned int) value : (unsigned int) value;
+    int n = 0, len = 0;
+
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (value < 0)
+        tmp[n++] = '-';
+
+    if ((size_t) n + 1 > size)
+        return -1;
+    while (n)
+        buffer[len++] = tmp[--n];
+    buffer[len++] = '\n';
+
+    return len;
+}
+
+/* Write value unless it is already there. */
+static int write_node(struct cached_node *node, int value)
+{
+    char buffer[16];
+    int len;
+    ssize_t amt;
+
+    if (value == node->value)
+        return 0;
+
+    len = format_int(buffer, sizeof(buffer), value);
+
+    if (node->fd < 0)
+        node->fd = open_node(node);
+    if (node->fd < 0)
+        return -ENOENT;
+
+    amt = pwrite(node->fd, buffer, len, 0);
+    if (amt < 0 && (errno == ENODEV || errno == EBADF)) {
+        /* The device went away underneath us; reopen once. */
+        close(node->fd);
+        node->fd = open_node(node);
+        if (node->fd < 0)
+            return -ENOENT;
+        amt = pwrite(node->fd, buffer, len, 0);
+    }
+
+    /* On error leave value alone so it is retried next time. */
+    if (amt < 0)
+        return -errno;
+
+    node->value = value;
+    return 0;
+}
+
+static void close_node(struct cached_node *node)
+{
+    if (node->fd >= 0)
+        close(node->fd);
+}
+
+static void init_node(struct cached_node *node, const char *path)
+{
+    node->path = path;
+    node->fd = -1;
+    node->value = -1;
+    node->fd = open_node(node);
+}
+
+static int property_get_int(const char *key, int def)
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    if (property_get(key, value, "") <= 0)
+        return def;
+    return atoi(value);
+}
+
+/* Store value in cache, returning true if it changed. */
+static bool sd_prop_store(atomic_int *cache, int value)
+{
+    return atomic_exchange(cache, value) != value;
+}
+
+/* Reload the cached properties, returning true if any of them changed. */
+static bool sd_props_load(void)
+{
+    bool changed = false;
+
+    changed |= sd_prop_store(&sd_enable_prop, property_get_int(SD_ENABLE_PROP, 0));
+    changed |= sd_prop_store(&sd_aggressiveness_prop,
+            property_get_int(SD_AGGRESSIVENESS_PROP, 0));
+    changed |= sd_prop_store(&sd_user_prop, property_get_int(SD_USER_PROP, 1));
+
+    return changed;
+}
+
+static int update_smartdimmer(struct backlight_device_t *bl, int level)
+{
+    int aggressiveness = atomic_load(&sd_aggressiveness_prop);
+    int enable = atomic_load(&sd_enable_prop) &&
+            atomic_load(&sd_user_prop) && aggressiveness > 0 &&
+            level >= SD_MIN_LEVEL;
+    int err;
+
+    if (!enable)
+        return write_node(&bl->sd_enable, 0);
+
+    if (level < SD_FULL_LEVEL && aggressiveness > SD_MILD_STEP)
+        aggressiveness -= SD_MILD_STEP;
+
+    /* Settle the strength before turning it on. */
+    err = write_node(&bl->sd_aggressiveness, aggressiveness);
+    if (!err)
+        err = write_node(&bl->sd_enable, 1);
+    return err;
 }
 
 static int rgb_to_brightness(struct light_state_t const *state)
@@ -61,16 +320,264 @@ static int rgb_to_brightness(struct light_state_t const *state)
         (29 * (color & 0x00ff))) >> 8;
 }
 
+/*
+ * Write level, with SmartDimmer following it: turned off before the level
+ * drops below where it is wanted and adjusted after it goes up.
+ */
+static int apply_backlight(struct backlight_device_t *bl, int level)
+{
+    int old = bl->brightness.value;
+    int err;
+
+    if (level == old)
+        return 0;
+
+    if (level < old)
+        update_smartdimmer(bl, level);
+    err = write_node(&bl->brightness, level);
+    if (!err && level > old)
+        update_smartdimmer(bl, level);
+
+    return err;
+}
+
+/* Write level from the writer thread, which has nobody to report to. */
+static void writer_apply(struct backlight_device_t *bl, int level)
+{
+    int err = apply_backlight(bl, level);
+
+    if (err)
+        ALOGE("failed to set backlight to %d: %s\n", level, strerror(-err));
+}
+
+#ifdef __BIONIC__
+/*
+ * Have the listening device re-evaluate SmartDimmer at its current level,
+ * through the writer when there is one.
+ */
+static void sd_notify(void)
+{
+    struct backlight_device_t *bl;
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&sd_listener_lock);
+    bl = sd_listener;
+    if (bl && bl->wake_fd >= 0) {
+        atomic_store(&bl->sd_dirty, true);
+        write(bl->wake_fd, &one, sizeof(one));
+    } else if (bl) {
+        pthread_mutex_lock(&bl->lock);
+        if (bl->brightness.value >= 0)
+            update_smartdimmer(bl, bl->brightness.value);
+        pthread_mutex_unlock(&bl->lock);
+    }
+    pthread_mutex_unlock(&sd_listener_lock);
+}
+
+static void *sd_watcher(void *arg)
+{
+    /* Take the serial first so a change during the reload is not missed. */
+    unsigned int serial = __system_property_area_serial();
+
+    (void) arg;
+
+    if (sd_props_load())
+        sd_notify();
+
+    for (;;) {
+        serial = __system_property_wait_any(serial);
+        if (sd_props_load())
+            sd_notify();
+    }
+
+    return NULL;
+}
+#endif
+
+static void sd_watch_start(void)
+{
+#ifdef __BIONIC__
+    pthread_t watcher;
+#endif
+
+    sd_props_load();
+
+#ifdef __BIONIC__
+    if (pthread_create(&watcher, NULL, sd_watcher, NULL))
+        ALOGE("failed to start SmartDimmer property watcher\n");
+    else
+        pthread_detach(watcher);
+#endif
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int isqrt(int64_t v)
+{
+    int64_t r = 0, bit = 1LL << 62;
+
+    while (bit > v)
+        bit >>= 2;
+    while (bit) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (int) r;
+}
+
+static int level_to_perceptual(int level)
+{
+    return isqrt((int64_t) level * PERCEPTUAL_MAX * PERCEPTUAL_MAX / MAX_LEVEL);
+}
+
+static int perceptual_to_level(int p)
+{
+    /* Round to nearest so the end points map back onto themselves. */
+    return (int) (((int64_t) p * p * MAX_LEVEL + PERCEPTUAL_MAX * PERCEPTUAL_MAX / 2) /
+            ((int64_t) PERCEPTUAL_MAX * PERCEPTUAL_MAX));
+}
+
+static void ramp_timer_set(struct backlight_device_t *bl, bool on)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    if (on) {
+        its.it_value.tv_nsec = RAMP_STEP_MS * NSEC_PER_MSEC;
+        its.it_interval.tv_nsec = RAMP_STEP_MS * NSEC_PER_MSEC;
+    }
+
+    if (timerfd_settime(bl->ramp_fd, 0, &its, NULL))
+        ALOGE("failed to arm backlight ramp timer: %s\n", strerror(errno));
+}
+
+/* Level for the current point of the ramp; ends the ramp when it is done. */
+static int ramp_level(struct backlight_device_t *bl)
+{
+    int64_t now = now_ns();
+    int64_t span = bl->ramp_end_ns - bl->ramp_start_ns;
+    int from, to;
+
+    if (now >= bl->ramp_end_ns) {
+        bl->ramp_end_ns = 0;
+        ramp_timer_set(bl, false);
+        return bl->ramp_to;
+    }
+
+    from = level_to_perceptual(bl->ramp_from);
+    to = level_to_perceptual(bl->ramp_to);
+    return perceptual_to_level(from + (int) ((to - from) * (now - bl->ramp_start_ns) / span));
+}
+
+static void backlight_request(struct backlight_device_t *bl, long long request)
+{
+    int level = request & 0xffff;
+    int ramp_ms = request >> 16;
+
+    /* Without a known starting point or a timer there is nothing to ramp. */
+    if (!ramp_ms || bl->brightness.value < 0 || bl->ramp_fd < 0 ||
+            level == bl->brightness.value) {
+        if (bl->ramp_end_ns) {
+            bl->ramp_end_ns = 0;
+            ramp_timer_set(bl, false);
+        }
+        writer_apply(bl, level);
+        return;
+    }
+
+    /* A new ramp starts from wherever the previous one had got to. */
+    bl->ramp_from = bl->brightness.value;
+    bl->ramp_to = level;
+    bl->ramp_start_ns = now_ns();
+    bl->ramp_end_ns = bl->ramp_start_ns + ramp_ms * NSEC_PER_MSEC;
+    ramp_timer_set(bl, true);
+}
+
+static void *backlight_writer(void *arg)
+{
+    struct backlight_device_t *bl = arg;
+    struct pollfd fds[2];
+    uint64_t count;
+    long long request;
+    int nfds = 1;
+
+    fds[0].fd = bl->wake_fd;
+    fds[0].events = POLLIN;
+    if (bl->ramp_fd >= 0) {
+        fds[1].fd = bl->ramp_fd;
+        fds[1].events = POLLIN;
+        nfds = 2;
+    }
+
+    while (!atomic_load(&bl->stop)) {
+        if (poll(fds, nfds, -1) <= 0)
+            continue;
+
+        if ((fds[0].revents & POLLIN) &&
+                read(bl->wake_fd, &count, sizeof(count)) == sizeof(count)) {
+            request = atomic_exchange(&bl->mailbox, -1);
+            if (request >= 0)
+                backlight_request(bl, request);
+            if (atomic_exchange(&bl->sd_dirty, false) && bl->brightness.value >= 0)
+                update_smartdimmer(bl, bl->brightness.value);
+        }
+
+        if (nfds > 1 && (fds[1].revents & POLLIN) &&
+                read(bl->ramp_fd, &count, sizeof(count)) == sizeof(count) &&
+                bl->ramp_end_ns)
+            writer_apply(bl, ramp_level(bl));
+    }
+
+    return NULL;
+}
+
 static int set_light_backlight(struct light_device_t *dev,
                    struct light_state_t const *state)
 {
+    struct backlight_device_t *bl = (struct backlight_device_t *)dev;
+    uint64_t one = 1;
     int err = 0;
     int brightness = rgb_to_brightness(state);
+    long long ramp_ms = 0;
+    long long request;
+
+    if (state->flashMode == LIGHT_FLASH_TIMED && state->flashOnMS > 0)
+        ramp_ms = state->flashOnMS < RAMP_MAX_MS ? state->flashOnMS : RAMP_MAX_MS;
+    request = ramp_ms << 16 | brightness;
+
+    if (atomic_exchange(&bl->requested, request) == request)
+        return 0;
+
+    if (bl->wake_fd < 0) {
+        /* No writer thread; fall back to writing inline, without ramps. */
+        pthread_mutex_lock(&bl->lock);
+        err = apply_backlight(bl, brightness);
+        pthread_mutex_unlock(&bl->lock);
+    } else if (atomic_exchange(&bl->mailbox, request) < 0 &&
+            write(bl->wake_fd, &one, sizeof(one)) < 0) {
+        /*
+         * Only wake the writer when the mailbox was empty; otherwise a
+         * wakeup is already pending and the writer will see the newer
+         * request.
+         */
+        err = -errno;
+    }
 
-    pthread_mutex_lock(&g_lock);
-    err = write_int("/sys/class/backlight/pwm-backlight/brightness",
-            brightness);
-    pthread_mutex_unlock(&g_lock);
+    /* Forget a request that did not go through so a repeat retries it. */
+    if (err)
+        atomic_compare_exchange_strong(&bl->requested, &request, -1);
 
     return err;
 }
@@ -78,8 +585,30 @@ static int set_light_backlight(struct light_device_t *dev,
 /** Close the lights device */
 static int close_lights(struct light_device_t *dev)
 {
-    if (dev)
-        free(dev);
+    struct backlight_device_t *bl = (struct backlight_device_t *)dev;
+
+    uint64_t one = 1;
+
+    if (bl) {
+        pthread_mutex_lock(&sd_listener_lock);
+        if (sd_listener == bl)
+            sd_listener = NULL;
+        pthread_mutex_unlock(&sd_listener_lock);
+
+        if (bl->wake_fd >= 0) {
+            atomic_store(&bl->stop, true);
+            write(bl->wake_fd, &one, sizeof(one));
+            pthread_join(bl->writer, NULL);
+            close(bl->wake_fd);
+        }
+        if (bl->ramp_fd >= 0)
+            close(bl->ramp_fd);
+        close_node(&bl->brightness);
+        close_node(&bl->sd_enable);
+        close_node(&bl->sd_aggressiveness);
+        pthread_mutex_destroy(&bl->lock);
+        free(bl);
+    }
     return 0;
 }
 
@@ -97,10 +626,39 @@ static int open_lights(const struct hw_module_t *module, char const *name,
     else
         return -EINVAL;
 
-    pthread_mutex_init(&g_lock, NULL);
+    struct backlight_device_t *bl = malloc(sizeof(struct backlight_device_t));
+    if (!bl)
+        return -ENOMEM;
+    memset(bl, 0, sizeof(*bl));
+
+    pthread_mutex_init(&bl->lock, NULL);
+    init_node(&bl->brightness, BACKLIGHT_PATH);
+    init_node(&bl->sd_enable, SMARTDIMMER_ENABLE_PATH);
+    init_node(&bl->sd_aggressiveness, SMARTDIMMER_AGGRESSIVENESS_PATH);
+    atomic_init(&bl->mailbox, -1);
+    atomic_init(&bl->requested, -1);
+    atomic_init(&bl->stop, false);
+    atomic_init(&bl->sd_dirty, false);
+    pthread_once(&sd_watch_once, sd_watch_start);
+
+    bl->ramp_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (bl->ramp_fd < 0)
+        ALOGE("failed to create backlight ramp timer: %s\n", strerror(errno));
+
+    bl->wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (bl->wake_fd < 0) {
+        ALOGE("failed to create backlight eventfd: %s\n", strerror(errno));
+    } else if (pthread_create(&bl->writer, NULL, backlight_writer, bl)) {
+        ALOGE("failed to start backlight writer thread\n");
+        close(bl->wake_fd);
+        bl->wake_fd = -1;
+    }
+
+    pthread_mutex_lock(&sd_listener_lock);
+    sd_listener = bl;
+    pthread_mutex_unlock(&sd_listener_lock);
 
-    struct light_device_t *dev = malloc(sizeof(struct light_device_t));
-    memset(dev, 0, sizeof(*dev));
+    struct light_device_t *dev = &bl->dev;
 
     dev->common.tag = HARDWARE_DEVICE_TAG;
     dev->common.version = 0;
@@ -15,13 +15,37 @@
 
 LOCAL_PATH := $(call my-dir)
 
+power_src_files := \
+    power.c \
+    boost.c \
+    cores.c \
+    energy.c \
+    input.c \
+    pm_qos.c \
+    profile.c \
+    stats.c \
+    sysfs.c \
+    thermal.c \
+    trace.c \
+    tunables.c
+
 # HAL module implemenation stored in
 # hw/<POWERS_HARDWARE_MODULE_ID>.<ro.hardware>.so
 include $(CLEAR_VARS)
 
 LOCAL_MODULE_PATH := $(TARGET_OUT_VENDOR_SHARED_LIBRARIES)/hw
 LOCAL_SHARED_LIBRARIES := liblog libcutils
-LOCAL_SRC_FILES := power.c
+LOCAL_SRC_FILES := $(power_src_files)
 LOCAL_MODULE := power.macallan
 LOCAL_MODULE_TAGS := optional
-include $(BUILD_SHARED_LIBRARY)
\ No newline at end of file
+include $(BUILD_SHARED_LIBRARY)
+
+# Host build of the same module, driven against a fake sysfs tree by
+# tools/halbench.
+include $(CLEAR_VARS)
+
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+LOCAL_SRC_FILES := $(power_src_files)
+LOCAL_MODULE := power.macallan_host
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_SHARED_LIBRARY)
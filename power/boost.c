@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#define LOG_TAG "Macallan PowerHAL"
+#include <utils/Log.h>
+
+#include "boost.h"
+#include "energy.h"
+#include "pm_qos.h"
+#include "sysfs.h"
+#include "util.h"
+
+#define CPU_MIN_FREQ_PATH "/sys/devices/system/cpu/cpu0/cpufreq/scaling_min_freq"
+#define CPUINFO_MIN_FREQ_PATH "/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_min_freq"
+#define HISPEED_FREQ_PATH "/sys/devices/system/cpu/cpufreq/interactive/hispeed_freq"
+
+/*
+ * App launches start from the bottom of the target_loads table and the
+ * interactive governor takes too long to ramp, so hold a high floor for
+ * the first couple of seconds.
+ */
+#define LAUNCH_MIN_FREQ "1224000"
+#define LAUNCH_HISPEED_FREQ "1530000"
+#define LAUNCH_BOOST_MS 2000
+
+#define SUSTAINED_MIN_FREQ "696000"
+
+/*
+ * While frames are being drawn keep a modest floor so the first frames of
+ * an animation do not run at the bottom of the table. The floor is held
+ * for a few frames after vsync stops, so vsync flapping on and off between
+ * frames does not turn into sysfs writes.
+ */
+#define VSYNC_MIN_FREQ "696000"
+#define VSYNC_HOLD_MS 64
+
+/*
+ * Many UI stalls are bound by memory or GPU bandwidth rather than CPU, so
+ * interaction and launch boosts also hold EMC and gbus floors through the
+ * PM QoS devices. Values in kHz.
+ */
+#define EMC_FREQ_MIN_PATH "/dev/emc_freq_min"
+#define GPU_FREQ_MIN_PATH "/dev/gpu_freq_min"
+
+#define INTERACTION_EMC_MIN_FREQ 408000
+#define INTERACTION_GPU_MIN_FREQ 252000
+#define LAUNCH_EMC_MIN_FREQ 792000
+#define LAUNCH_GPU_MIN_FREQ 396000
+
+#define FREQ_LEN 16
+
+static pthread_mutex_t boost_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t boost_thread;
+static int boost_timer_fd = -1;
+static int boost_wake_fd = -1;
+static bool launch_active;
+static bool sustained_active;
+static bool vsync_active;
+static bool interaction_active;
+
+/* Absolute CLOCK_MONOTONIC release times, 0 when not pending. */
+static int64_t launch_deadline_ns;
+static int64_t vsync_deadline_ns;
+static int64_t interaction_deadline_ns;
+
+/*
+ * Interaction boosts come in on the hint path, which takes no locks. The
+ * release time is published here and the boost thread applies and drops
+ * the floors; it is only woken when they are not held already.
+ */
+static atomic_llong interaction_request_ns;
+static atomic_bool interaction_held;
+
+static struct pm_qos_request emc_freq_min = PM_QOS_REQUEST_INIT(EMC_FREQ_MIN_PATH);
+static struct pm_qos_request gpu_freq_min = PM_QOS_REQUEST_INIT(GPU_FREQ_MIN_PATH);
+
+/*
+ * Values in effect without any boost. The floor is read back at init, the
+ * hispeed frequency comes from the governor tunables. While either is
+ * unknown it is left alone, since a boost could never be released.
+ */
+static char default_min_freq[FREQ_LEN];
+static char default_hispeed_freq[FREQ_LEN];
+
+/*
+ * Values last written to scaling_min_freq and hispeed_freq, empty if
+ * none or the write failed. boost_apply() runs on every boost change, so
+ * writes that would not change anything are skipped.
+ */
+static char written_min_freq[FREQ_LEN];
+static char written_hispeed_freq[FREQ_LEN];
+
+/*
+ * The scaling_max_freq cap currently in force, 0 if unknown. The kernel
+ * rejects a floor above the cap, so floors are clamped to it.
+ */
+static int ceiling_khz;
+
+/* Write value to path unless written already holds it. */
+static void boost_write(const char *path, char *written, const char *value)
+{
+    if (!strcmp(written, value))
+        return;
+
+    if (sysfs_write(path, value))
+        written[0] = '\0';
+    else
+        snprintf(written, FREQ_LEN, "%s", value);
+}
+
+/* Must be called with boost_lock held. */
+static void boost_apply(void)
+{
+    const char *min_freq = default_min_freq;
+    const char *hispeed_freq = default_hispeed_freq;
+    char clamped[FREQ_LEN];
+    int32_t emc_freq = 0;
+    int32_t gpu_freq = 0;
+
+    if (sustained_active) {
+        min_freq = SUSTAINED_MIN_FREQ;
+    } else if (launch_active) {
+        min_freq = LAUNCH_MIN_FREQ;
+        hispeed_freq = LAUNCH_HISPEED_FREQ;
+        emc_freq = LAUNCH_EMC_MIN_FREQ;
+        gpu_freq = LAUNCH_GPU_MIN_FREQ;
+    } else if (interaction_active) {
+        emc_freq = INTERACTION_EMC_MIN_FREQ;
+        gpu_freq = INTERACTION_GPU_MIN_FREQ;
+        if (vsync_active)
+            min_freq = VSYNC_MIN_FREQ;
+    } else if (vsync_active) {
+        min_freq = VSYNC_MIN_FREQ;
+    }
+
+    if (!default_min_freq[0])
+        min_freq = default_min_freq;
+    if (!default_hispeed_freq[0])
+        hispeed_freq = default_hispeed_freq;
+
+    if (ceiling_khz && atoi(min_freq) > ceiling_khz) {
+        snprintf(clamped, sizeof(clamped), "%d", ceiling_khz);
+        min_freq = clamped;
+    }
+
+    if (min_freq[0])
+        boost_write(CPU_MIN_FREQ_PATH, written_min_freq, min_freq);
+    if (hispeed_freq[0])
+        boost_write(HISPEED_FREQ_PATH, written_hispeed_freq, hispeed_freq);
+
+    pm_qos_update(&emc_freq_min, emc_freq);
+    pm_qos_update(&gpu_freq_min, gpu_freq);
+
+    energy_update(ENERGY_BOOST_BITS,
+            (vsync_active ? ENERGY_VSYNC : 0) |
+            (interaction_active ? ENERGY_INTERACTION : 0) |
+            (sustained_active ? ENERGY_SUSTAINED : 0) |
+            (launch_active ? ENERGY_LAUNCH : 0));
+}
+
+/*
+ * Arm the timer for the earliest pending release, or disarm it if nothing
+ * is pending. Must be called with boost_lock held.
+ */
+static void boost_timer_update(void)
+{
+    struct itimerspec its;
+    int64_t deadline = launch_deadline_ns;
+
+    if (vsync_deadline_ns && (!deadline || vsync_deadline_ns < deadline))
+        deadline = vsync_deadline_ns;
+    if (interaction_deadline_ns && (!deadline || interaction_deadline_ns < deadline))
+        deadline = interaction_deadline_ns;
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = deadline / NSEC_PER_SEC;
+    its.it_value.tv_nsec = deadline % NSEC_PER_SEC;
+
+    if (timerfd_settime(boost_timer_fd, TFD_TIMER_ABSTIME, &its, NULL))
+        ALOGE("Error arming boost timer: %s\n", strerror(errno));
+}
+
+/*
+ * Pick up the latest interaction request. Before dropping the floors the
+ * held flag is cleared and the request read again, so a request published
+ * meanwhile either is seen here or wakes the thread. Must be called with
+ * boost_lock held.
+ */
+static void interaction_fold(int64_t now)
+{
+    int64_t deadline = atomic_load(&interaction_request_ns);
+
+    if (deadline <= now && interaction_active) {
+        atomic_store(&interaction_held, false);
+        deadline = atomic_load(&interaction_request_ns);
+    }
+
+    if (deadline > now) {
+        atomic_store(&interaction_held, true);
+        interaction_active = true;
+        interaction_deadline_ns = deadline;
+    } else {
+        interaction_active = false;
+        interaction_deadline_ns = 0;
+    }
+}
+
+static void *boost_timer_loop(void *arg)
+{
+    struct pollfd fds[2];
+    uint64_t count;
+    int64_t now;
+
+    fds[0].fd = boost_timer_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = boost_wake_fd;
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        if (poll(fds, 2, -1) <= 0)
+            continue;
+
+        if (fds[0].revents & POLLIN)
+            read(boost_timer_fd, &count, sizeof(count));
+        if (fds[1].revents & POLLIN)
+            read(boost_wake_fd, &count, sizeof(count));
+
+        pthread_mutex_lock(&boost_lock);
+        now = now_ns();
+        if (launch_deadline_ns && now >= launch_deadline_ns) {
+            launch_active = false;
+            launch_deadline_ns = 0;
+        }
+        if (vsync_deadline_ns && now >= vsync_deadline_ns) {
+            vsync_active = false;
+            vsync_deadline_ns = 0;
+        }
+        interaction_fold(now);
+        boost_apply();
+        boost_timer_update();
+        pthread_mutex_unlock(&boost_lock);
+    }
+
+    return NULL;
+}
+
+void boost_init(void)
+{
+    pthread_mutex_lock(&boost_lock);
+
+    if (boost_timer_fd >= 0) {
+        pthread_mutex_unlock(&boost_lock);
+        return;
+    }
+
+    if (sysfs_read(CPU_MIN_FREQ_PATH, default_min_freq, sizeof(default_min_freq)) ||
+            !default_min_freq[0]) {
+        if (sysfs_read(CPUINFO_MIN_FREQ_PATH, default_min_freq, sizeof(default_min_freq)))
+            default_min_freq[0] = '\0';
+        if (!default_min_freq[0])
+            ALOGE("No default CPU floor, frequency boosts disabled\n");
+    }
+
+    boost_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    boost_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (boost_timer_fd < 0 || boost_wake_fd < 0) {
+        ALOGE("Error creating boost timer: %s\n", strerror(errno));
+        goto err;
+    }
+
+    if (pthread_create(&boost_thread, NULL, boost_timer_loop, NULL)) {
+        ALOGE("Error creating boost timer thread\n");
+        goto err;
+    }
+
+    pthread_mutex_unlock(&boost_lock);
+    return;
+
+err:
+    if (boost_timer_fd >= 0)
+        close(boost_timer_fd);
+    if (boost_wake_fd >= 0)
+        close(boost_wake_fd);
+    boost_timer_fd = -1;
+    boost_wake_fd = -1;
+
+    pthread_mutex_unlock(&boost_lock);
+}
+
+void boost_set_default_hispeed(const char *freq)
+{
+    pthread_mutex_lock(&boost_lock);
+    snprintf(default_hispeed_freq, sizeof(default_hispeed_freq), "%s", freq);
+    boost_apply();
+    pthread_mutex_unlock(&boost_lock);
+}
+
+void boost_set_ceiling(int khz)
+{
+    pthread_mutex_lock(&boost_lock);
+    ceiling_khz = khz;
+    boost_apply();
+    pthread_mutex_unlock(&boost_lock);
+}
+
+void boost_launch(bool start)
+{
+    pthread_mutex_lock(&boost_lock);
+
+    /* Without a timer nothing would ever release the boost. */
+    if (boost_timer_fd < 0) {
+        pthread_mutex_unlock(&boost_lock);
+        return;
+    }
+
+    launch_active = start;
+    launch_deadline_ns = start ? now_ns() + LAUNCH_BOOST_MS * NSEC_PER_MSEC : 0;
+    boost_timer_update();
+    boost_apply();
+
+    pthread_mutex_unlock(&boost_lock);
+}
+
+void boost_interaction(int64_t duration_ns)
+{
+    uint64_t one = 1;
+
+    if (boost_wake_fd < 0)
+        return;
+
+    atomic_store(&interaction_request_ns, now_ns() + duration_ns);
+    if (!atomic_load(&interaction_held))
+        write(boost_wake_fd, &one, sizeof(one));
+}
+
+void boost_sustained(bool on)
+{
+    pthread_mutex_lock(&boost_lock);
+    sustained_active = on;
+    boost_apply();
+    pthread_mutex_unlock(&boost_lock);
+}
+
+bool boost_sustained_active(void)
+{
+    bool active;
+
+    pthread_mutex_lock(&boost_lock);
+    active = sustained_active;
+    pthread_mutex_unlock(&boost_lock);
+
+    return active;
+}
+
+void boost_vsync(bool on)
+{
+    pthread_mutex_lock(&boost_lock);
+
+    if (boost_timer_fd < 0) {
+        pthread_mutex_unlock(&boost_lock);
+        return;
+    }
+
+    if (on) {
+        /* Cancel a pending release; the floor is still in place. */
+        if (vsync_deadline_ns) {
+            vsync_deadline_ns = 0;
+            boost_timer_update();
+        }
+        if (!vsync_active) {
+            vsync_active = true;
+            boost_apply();
+        }
+    } else if (vsync_active && !vsync_deadline_ns) {
+        vsync_deadline_ns = now_ns() + VSYNC_HOLD_MS * NSEC_PER_MSEC;
+        boost_timer_update();
+    }
+
+    pthread_mutex_unlock(&boost_lock);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_POWER_BOOST_H
+#define MACALLAN_POWER_BOOST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Past 1224000 the per-step current in power_profile.xml jumps sharply,
+ * so that is the top of the band we can hold without hitting thermal
+ * throttling. Applied as the scaling_max_freq cap by power.c.
+ */
+#define SUSTAINED_MAX_FREQ 1224000
+
+/*
+ * Timed and sustained CPU boosts. The boost code owns scaling_min_freq,
+ * the governor's hispeed_freq and the EMC and GPU floor requests; the
+ * scaling_max_freq cap stays with the screen and low power state in
+ * power.c.
+ */
+void boost_init(void);
+
+/* hispeed_freq to restore when no boost is held. */
+void boost_set_default_hispeed(const char *freq);
+
+/*
+ * Clamp any floor to the scaling_max_freq cap. Call before lowering the
+ * cap and after raising it, so the kernel never sees min above max.
+ */
+void boost_set_ceiling(int khz);
+
+/* Raise the frequency floor for an app launch, released by a timer. */
+void boost_launch(bool start);
+
+/*
+ * Hold the EMC and GPU floors for the length of a forwarded boostpulse.
+ * The CPU side of an interaction boost is the governor's own boostpulse.
+ * Takes no locks; the floors are applied by the boost thread.
+ */
+void boost_interaction(int64_t duration_ns);
+
+/* Hold a frequency floor while frames are being drawn. */
+void boost_vsync(bool on);
+
+/* Pin the CPU to a thermally sustainable band instead of bursting. */
+void boost_sustained(bool on);
+bool boost_sustained_active(void);
+
+#endif // MACALLAN_POWER_BOOST_H
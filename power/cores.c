@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
+
+#define LOG_TAG "Macallan PowerHAL"
+#include <utils/Log.h>
+
+#include "cores.h"
+#include "pm_qos.h"
+#include "sysfs.h"
+
+#define CLUSTER_ACTIVE_PATH "/sys/kernel/cluster/active"
+#define CPU_ONLINE_PATH "/sys/devices/system/cpu/online"
+
+/* PM QoS limit on the number of online CPUs, as cpuquiet honours it. */
+#define MAX_ONLINE_CPUS_PATH "/dev/max_online_cpus"
+
+/* Matches NV_MAX_CORES for maxbatterylife in power.macallan.rc. */
+#define LOW_POWER_MAX_CORES 2
+#define SCREEN_OFF_MAX_CORES 1
+
+/*
+ * The cluster switch is refused while more than one CPU is online, and
+ * cpuquiet takes a while to act on the max_online_cpus request, so the
+ * switch to LP is retried until it does or we give up.
+ */
+#define CLUSTER_RETRY_MS 50
+#define CLUSTER_RETRY_MAX 40
+
+static pthread_mutex_t cores_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct pm_qos_request max_online_cpus =
+        PM_QOS_REQUEST_INIT(MAX_ONLINE_CPUS_PATH);
+
+static int cluster_timer_fd = -1;
+static pthread_t cluster_thread;
+static bool lp_pending;
+static int lp_retries;
+
+static void cluster_timer_arm(bool on)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    if (on) {
+        its.it_value.tv_nsec = CLUSTER_RETRY_MS * 1000000L;
+        its.it_interval.tv_nsec = CLUSTER_RETRY_MS * 1000000L;
+    }
+
+    if (timerfd_settime(cluster_timer_fd, 0, &its, NULL))
+        ALOGE("Error %s cluster timer: %s\n", on ? "arming" : "disarming",
+                strerror(errno));
+}
+
+/* Called with cores_lock held. Returns true once nothing is left to do. */
+static bool try_lp_switch(void)
+{
+    char online[16];
+
+    if (!sysfs_read(CPU_ONLINE_PATH, online, sizeof(online)) &&
+            !strcmp(online, "0") && !sysfs_write(CLUSTER_ACTIVE_PATH, "LP"))
+        return true;
+
+    if (++lp_retries >= CLUSTER_RETRY_MAX) {
+        ALOGW("Giving up switching to the LP cluster\n");
+        return true;
+    }
+
+    return false;
+}
+
+static void *cluster_loop(void *arg)
+{
+    uint64_t expirations;
+
+    (void) arg;
+
+    for (;;) {
+        if (read(cluster_timer_fd, &expirations, sizeof(expirations)) !=
+                sizeof(expirations))
+            continue;
+
+        pthread_mutex_lock(&cores_lock);
+        if (lp_pending && try_lp_switch()) {
+            lp_pending = false;
+            cluster_timer_arm(false);
+        }
+        pthread_mutex_unlock(&cores_lock);
+    }
+
+    return NULL;
+}
+
+void cores_init(void)
+{
+    if (cluster_timer_fd >= 0)
+        return;
+
+    cluster_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (cluster_timer_fd < 0) {
+        ALOGE("Error creating cluster timer: %s\n", strerror(errno));
+        return;
+    }
+
+    if (pthread_create(&cluster_thread, NULL, cluster_loop, NULL)) {
+        ALOGE("Error starting cluster thread\n");
+        close(cluster_timer_fd);
+        cluster_timer_fd = -1;
+    }
+}
+
+void cores_update(bool screen_on, bool low_power)
+{
+    pthread_mutex_lock(&cores_lock);
+
+    if (screen_on) {
+        if (lp_pending) {
+            lp_pending = false;
+            cluster_timer_arm(false);
+        }
+        /* cpuquiet may have parked us on LP; get the G cluster back now. */
+        sysfs_write(CLUSTER_ACTIVE_PATH, "G");
+        pm_qos_update(&max_online_cpus, low_power ? LOW_POWER_MAX_CORES : 0);
+    } else {
+        pm_qos_update(&max_online_cpus, SCREEN_OFF_MAX_CORES);
+        lp_retries = 0;
+        if (!lp_pending && !try_lp_switch() && cluster_timer_fd >= 0) {
+            lp_pending = true;
+            cluster_timer_arm(true);
+        }
+    }
+
+    pthread_mutex_unlock(&cores_lock);
+}
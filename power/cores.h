@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_POWER_CORES_H
+#define MACALLAN_POWER_CORES_H
+
+#include <stdbool.h>
+
+/* Starts the thread that retries the switch to the LP cluster. */
+void cores_init(void);
+
+/*
+ * Core and cluster management. With the screen off everything is moved
+ * to the LP companion core; low power mode limits the number of online G
+ * cores. Call before raising the CPU cap when coming back to the G cluster
+ * and after lowering it when leaving it. The switch to LP waits for
+ * cpuquiet to take the other CPUs offline and may complete later.
+ */
+void cores_update(bool screen_on, bool low_power);
+
+#endif // MACALLAN_POWER_CORES_H
@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#define LOG_TAG "Macallan PowerHAL"
+#include <utils/Log.h>
+
+#include "energy.h"
+#include "sysfs.h"
+#include "util.h"
+
+#define TIME_IN_STATE_PATH "/sys/devices/system/cpu/cpu0/cpufreq/stats/time_in_state"
+#define PROC_STAT_PATH "/proc/stat"
+
+#define CPU_MAX 8
+#define TIME_IN_STATE_LEN 1024
+#define PROC_STAT_LEN 2048
+
+/*
+ * cpu.speeds and cpu.active from overlay/.../power_profile.xml. The
+ * overlay only exists inside framework-res on the device, so the table
+ * is kept here as well and has to be updated with it. Currents in mA.
+ */
+static const struct {
+    int khz;
+    double ma;
+} cpu_active[] = {
+    {   51000,   4.00 },
+    {  102000,   8.00 },
+    {  204000,  15.00 },
+    {  304000,  22.50 },
+    {  433898,  67.25 },
+    {  613195,  90.25 },
+    {  792492, 122.75 },
+    {  817593, 125.25 },
+    {  918000, 137.75 },
+    { 1020000, 216.00 },
+    { 1122000, 237.75 },
+    { 1224000, 265.00 },
+    { 1326000, 430.75 },
+    { 1428000, 471.00 },
+    { 1530000, 507.50 },
+    { 1606500, 531.75 },
+    { 1708500, 576.75 },
+    { 1810500, 630.25 },
+    { 1912500, 689.00 },
+};
+
+#define CPU_SPEEDS (sizeof(cpu_active) / sizeof(cpu_active[0]))
+
+/* cpu.awake, drawn whenever the SoC is not suspended. */
+#define CPU_AWAKE_MA 0.5
+
+enum energy_mode {
+    ENERGY_MODE_SCREEN_OFF,
+    ENERGY_MODE_INTERACTIVE,
+    ENERGY_MODE_LOW_POWER,
+    ENERGY_MODE_VSYNC,
+    ENERGY_MODE_INTERACTION,
+    ENERGY_MODE_SUSTAINED,
+    ENERGY_MODE_LAUNCH,
+    ENERGY_MODE_MAX
+};
+
+static const char *const energy_mode_names[ENERGY_MODE_MAX] = {
+    [ENERGY_MODE_SCREEN_OFF] = "screen off",
+    [ENERGY_MODE_INTERACTIVE] = "interactive",
+    [ENERGY_MODE_LOW_POWER] = "low power",
+    [ENERGY_MODE_VSYNC] = "vsync boost",
+    [ENERGY_MODE_INTERACTION] = "interaction boost",
+    [ENERGY_MODE_SUSTAINED] = "sustained performance",
+    [ENERGY_MODE_LAUNCH] = "launch boost",
+};
+
+struct energy_account {
+    int64_t wall_ns;
+    int64_t busy_ms;
+    int64_t idle_ms;
+    int64_t speed_ms[CPU_SPEEDS];
+    double mah;
+};
+
+static pthread_mutex_t energy_lock = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * Serialises samples. The counters are read outside energy_lock, which
+ * energy_update() takes on the hint path.
+ */
+static pthread_mutex_t sample_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool energy_ready;
+static unsigned int energy_bits = ENERGY_SCREEN_ON;
+static enum energy_mode energy_mode = ENERGY_MODE_INTERACTIVE;
+static struct energy_account accounts[ENERGY_MODE_MAX];
+
+/*
+ * Mode changes come in on the hint path, so the counters are read by a
+ * thread of our own, woken through sample_fd.
+ */
+static int sample_fd = -1;
+static pthread_t sample_thread;
+
+/* Wall time spent in each mode since the last sample. */
+static int64_t pending_ns[ENERGY_MODE_MAX];
+static int64_t mode_since_ns;
+
+static int time_in_state_fd = -1;
+static int proc_stat_fd = -1;
+static long clock_ticks;
+
+struct cpu_ticks {
+    bool seen;
+    uint64_t busy;
+    uint64_t idle;
+};
+
+/* Counters at the last sample. */
+static int64_t last_ns;
+static uint64_t last_ticks[CPU_SPEEDS];
+static struct cpu_ticks last_cpu_ticks[CPU_MAX];
+
+/* Boosts win over the screen state; launch is the most specific. */
+static enum energy_mode energy_mode_of(unsigned int bits)
+{
+    if (!(bits & ENERGY_SCREEN_ON))
+        return ENERGY_MODE_SCREEN_OFF;
+    if (bits & ENERGY_LAUNCH)
+        return ENERGY_MODE_LAUNCH;
+    if (bits & ENERGY_SUSTAINED)
+        return ENERGY_MODE_SUSTAINED;
+    if (bits & ENERGY_INTERACTION)
+        return ENERGY_MODE_INTERACTION;
+    if (bits & ENERGY_VSYNC)
+        return ENERGY_MODE_VSYNC;
+    if (bits & ENERGY_LOW_POWER)
+        return ENERGY_MODE_LOW_POWER;
+    return ENERGY_MODE_INTERACTIVE;
+}
+
+/* Index of the highest table speed not above khz. */
+static int speed_index(int khz)
+{
+    int i;
+
+    for (i = CPU_SPEEDS - 1; i > 0; i--)
+        if (cpu_active[i].khz <= khz)
+            break;
+
+    return i;
+}
+
+static int open_counter(const char *path)
+{
+    char buf[80];
+    char real_path[PATH_MAX];
+    int fd = open(sysfs_path(path, real_path, sizeof(real_path)), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error opening %s: %s\n", path, buf);
+    }
+
+    return fd;
+}
+
+static ssize_t read_counter(int fd, char *s, size_t size)
+{
+    ssize_t len = pread(fd, s, size - 1, 0);
+
+    s[len > 0 ? len : 0] = '\0';
+    return len;
+}
+
+/* "<khz> <ticks>" per line, accumulated onto the nearest table speed. */
+static void read_time_in_state(uint64_t *ticks)
+{
+    char buf[TIME_IN_STATE_LEN];
+    char *p, *end;
+    long khz;
+
+    memset(ticks, 0, sizeof(*ticks) * CPU_SPEEDS);
+    if (time_in_state_fd < 0 || read_counter(time_in_state_fd, buf, sizeof(buf)) <= 0)
+        return;
+
+    for (p = buf; *p; p = end) {
+        khz = strtol(p, &end, 10);
+        if (end == p)
+            break;
+        p = end;
+        ticks[speed_index(khz)] += strtoull(p, &end, 10);
+        if (end == p)
+            break;
+    }
+}
+
+/*
+ * Busy and idle ticks of every online CPU from the "cpuN" lines. Offline
+ * CPUs are missing and keep their previous counters, which the kernel
+ * also leaves alone until they come back.
+ */
+static void read_cpu_ticks(struct cpu_ticks *cpus)
+{
+    char buf[PROC_STAT_LEN];
+    unsigned long long t[8];
+    char *p;
+    int cpu;
+
+    if (proc_stat_fd < 0 || read_counter(proc_stat_fd, buf, sizeof(buf)) <= 0)
+        return;
+
+    for (p = buf; p; p = strchr(p, '\n')) {
+        if (*p == '\n')
+            p++;
+        if (strncmp(p, "cpu", 3))
+            break;
+        memset(t, 0, sizeof(t));
+        /* user nice system idle iowait irq softirq steal */
+        if (sscanf(p, "cpu%d %llu %llu %llu %llu %llu %llu %llu %llu", &cpu,
+                    &t[0], &t[1], &t[2], &t[3], &t[4], &t[5], &t[6], &t[7]) < 5 ||
+                cpu < 0 || cpu >= CPU_MAX)
+            continue;
+        cpus[cpu].seen = true;
+        cpus[cpu].busy = t[0] + t[1] + t[2] + t[5] + t[6] + t[7];
+        cpus[cpu].idle = t[3] + t[4];
+    }
+}
+
+static int64_t ticks_to_ms(uint64_t now, uint64_t last)
+{
+    return now >= last ? (int64_t) ((now - last) * 1000 / clock_ticks) : 0;
+}
+
+/*
+ * Charge everything since the last sample. CPU time comes from /proc/stat
+ * summed over the online CPUs; the cores share one clock, so busy time is
+ * spread over the speeds in the proportions cpu0's time_in_state saw over
+ * the same window. cpu.awake is charged over the whole window, since
+ * CLOCK_MONOTONIC does not advance in suspend.
+ *
+ * Every mode change wakes the sampler thread, so a window normally covers
+ * a single mode. Changes that come in faster than the sampler runs share
+ * their window out by wall time. Must be called with energy_lock held,
+ * with the counters read under sample_lock.
+ */
+static void energy_charge(const uint64_t *ticks, struct cpu_ticks *cpus)
+{
+    struct energy_account *account;
+    int64_t now = now_ns();
+    int64_t window_ns, speed_total = 0, speed_ms[CPU_SPEEDS];
+    int64_t busy_ms = 0, idle_ms = 0;
+    double charge = CPU_AWAKE_MA * (now - last_ns) / NSEC_PER_MSEC;
+    double share;
+    unsigned int i, m;
+
+    pending_ns[energy_mode] += now - mode_since_ns;
+    mode_since_ns = now;
+
+    for (i = 0; i < CPU_SPEEDS; i++) {
+        speed_ms[i] = ticks_to_ms(ticks[i], last_ticks[i]);
+        speed_total += speed_ms[i];
+        last_ticks[i] = ticks[i];
+    }
+
+    for (i = 0; i < CPU_MAX; i++) {
+        if (!cpus[i].seen)
+            continue;
+        /* A CPU seen for the first time only sets its baseline. */
+        if (last_cpu_ticks[i].seen) {
+            busy_ms += ticks_to_ms(cpus[i].busy, last_cpu_ticks[i].busy);
+            idle_ms += ticks_to_ms(cpus[i].idle, last_cpu_ticks[i].idle);
+        }
+        last_cpu_ticks[i] = cpus[i];
+    }
+
+    /* Busy CPU time at each speed. */
+    for (i = 0; i < CPU_SPEEDS; i++) {
+        speed_ms[i] = speed_total ? busy_ms * speed_ms[i] / speed_total : 0;
+        charge += speed_ms[i] * cpu_active[i].ma;
+    }
+
+    window_ns = now - last_ns;
+    last_ns = now;
+
+    for (m = 0; m < ENERGY_MODE_MAX; m++) {
+        if (!pending_ns[m])
+            continue;
+        account = &accounts[m];
+        share = window_ns ? (double) pending_ns[m] / window_ns : 0;
+        account->wall_ns += pending_ns[m];
+        account->busy_ms += busy_ms * share;
+        account->idle_ms += idle_ms * share;
+        for (i = 0; i < CPU_SPEEDS; i++)
+            account->speed_ms[i] += speed_ms[i] * share;
+        /* mA * ms to mAh */
+        account->mah += charge * share / (3600.0 * 1000.0);
+        pending_ns[m] = 0;
+    }
+}
+
+static void *energy_sample_loop(void *arg)
+{
+    uint64_t count;
+
+    (void) arg;
+
+    for (;;) {
+        if (read(sample_fd, &count, sizeof(count)) == sizeof(count))
+            energy_sample();
+    }
+
+    return NULL;
+}
+
+void energy_init(void)
+{
+    char buf[80];
+
+    pthread_mutex_lock(&energy_lock);
+
+    if (energy_ready) {
+        pthread_mutex_unlock(&energy_lock);
+        return;
+    }
+
+    clock_ticks = sysconf(_SC_CLK_TCK);
+    if (clock_ticks <= 0)
+        clock_ticks = 100;
+
+    time_in_state_fd = open_counter(TIME_IN_STATE_PATH);
+    /* Not a sysfs node, so not redirected with the rest of them. */
+    proc_stat_fd = open(PROC_STAT_PATH, O_RDONLY | O_CLOEXEC);
+    if (proc_stat_fd < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error opening %s: %s\n", PROC_STAT_PATH, buf);
+    }
+
+    /* Start from the current counters; nothing before init is charged. */
+    read_time_in_state(last_ticks);
+    read_cpu_ticks(last_cpu_ticks);
+    last_ns = now_ns();
+    mode_since_ns = last_ns;
+    energy_ready = true;
+
+    sample_fd = eventfd(0, EFD_CLOEXEC);
+    if (sample_fd < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error creating energy sampler eventfd: %s\n", buf);
+    } else if (pthread_create(&sample_thread, NULL, energy_sample_loop, NULL)) {
+        ALOGE("Error starting energy sampler thread\n");
+        close(sample_fd);
+        sample_fd = -1;
+    }
+
+    pthread_mutex_unlock(&energy_lock);
+}
+
+void energy_update(unsigned int mask, unsigned int bits)
+{
+    enum energy_mode mode;
+    uint64_t one = 1;
+    bool changed = false;
+    int64_t now;
+
+    pthread_mutex_lock(&energy_lock);
+
+    energy_bits = (energy_bits & ~mask) | (bits & mask);
+    mode = energy_mode_of(energy_bits);
+    if (mode != energy_mode) {
+        if (energy_ready) {
+            now = now_ns();
+            pending_ns[energy_mode] += now - mode_since_ns;
+            mode_since_ns = now;
+            changed = true;
+        }
+        energy_mode = mode;
+    }
+
+    pthread_mutex_unlock(&energy_lock);
+
+    /* Close the window of the mode just left. */
+    if (changed && sample_fd >= 0)
+        write(sample_fd, &one, sizeof(one));
+}
+
+void energy_sample(void)
+{
+    struct cpu_ticks cpus[CPU_MAX];
+    uint64_t ticks[CPU_SPEEDS];
+
+    pthread_mutex_lock(&sample_lock);
+
+    pthread_mutex_lock(&energy_lock);
+    if (!energy_ready) {
+        pthread_mutex_unlock(&energy_lock);
+        pthread_mutex_unlock(&sample_lock);
+        return;
+    }
+    memcpy(cpus, last_cpu_ticks, sizeof(cpus));
+    pthread_mutex_unlock(&energy_lock);
+
+    read_time_in_state(ticks);
+    read_cpu_ticks(cpus);
+
+    pthread_mutex_lock(&energy_lock);
+    energy_charge(ticks, cpus);
+    pthread_mutex_unlock(&energy_lock);
+
+    pthread_mutex_unlock(&sample_lock);
+}
+
+void energy_dump(FILE *f)
+{
+    struct energy_account *account;
+    unsigned int i, j;
+
+    /* Bring the current mode up to date before reporting. */
+    energy_sample();
+
+    pthread_mutex_lock(&energy_lock);
+
+    if (!energy_ready) {
+        pthread_mutex_unlock(&energy_lock);
+        return;
+    }
+
+    fprintf(f, "energy: estimated CPU charge per mode\n");
+    for (i = 0; i < ENERGY_MODE_MAX; i++) {
+        account = &accounts[i];
+        if (!account->wall_ns)
+            continue;
+        fprintf(f, "%s%s: %lld ms, %lld ms busy, %lld ms idle, %.3f mAh, avg %.1f mA\n",
+                energy_mode_names[i], i == energy_mode ? " (current)" : "",
+                (long long) (account->wall_ns / NSEC_PER_MSEC),
+                (long long) account->busy_ms, (long long) account->idle_ms,
+                account->mah, account->mah * 3600.0 * NSEC_PER_SEC / account->wall_ns);
+        for (j = 0; j < CPU_SPEEDS; j++)
+            if (account->speed_ms[j])
+                fprintf(f, "    %d: %lld ms\n", cpu_active[j].khz,
+                        (long long) account->speed_ms[j]);
+    }
+
+    pthread_mutex_unlock(&energy_lock);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_POWER_ENERGY_H
+#define MACALLAN_POWER_ENERGY_H
+
+#include <stdio.h>
+
+/*
+ * State feeding the power mode that CPU time is charged to. power.c owns
+ * the screen and low power bits, boost.c the boost bits.
+ */
+#define ENERGY_SCREEN_ON    (1u << 0)
+#define ENERGY_LOW_POWER    (1u << 1)
+#define ENERGY_VSYNC        (1u << 2)
+#define ENERGY_INTERACTION  (1u << 3)
+#define ENERGY_SUSTAINED    (1u << 4)
+#define ENERGY_LAUNCH       (1u << 5)
+
+#define ENERGY_SCREEN_BITS  (ENERGY_SCREEN_ON | ENERGY_LOW_POWER)
+#define ENERGY_BOOST_BITS   (ENERGY_VSYNC | ENERGY_INTERACTION | \
+                             ENERGY_SUSTAINED | ENERGY_LAUNCH)
+
+/*
+ * Per-mode energy accounting, using the cpu.active and cpu.awake currents
+ * from power_profile.xml. Mode changes record the time and wake a
+ * sampler thread, which reads the CPU counters with energy_sample() and
+ * charges the window since the previous sample to the modes it covered.
+ */
+void energy_init(void);
+
+/* Replace the bits in mask with those in bits. Does no sysfs reads. */
+void energy_update(unsigned int mask, unsigned int bits);
+
+/* Read the CPU counters and charge the modes since the last sample. */
+void energy_sample(void);
+
+void energy_dump(FILE *f);
+
+#endif // MACALLAN_POWER_ENERGY_H
@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define LOG_TAG "Macallan PowerHAL"
+#include <utils/Log.h>
+#include <cutils/uevent.h>
+
+#include "input.h"
+#include "sysfs.h"
+#include "util.h"
+
+#define INPUT_CLASS_PATH "/sys/class/input"
+#define INPUT_DEV_MAX 32
+#define INPUT_NAME_MAX 64
+#define UEVENT_MSG_LEN 2048
+
+/* Toggles slower than this are logged as they happen. */
+#define INPUT_SLOW_TOGGLE_NS (2 * NSEC_PER_MSEC)
+
+struct input_dev {
+    bool used;
+    int id;
+    int fd;
+    char name[INPUT_NAME_MAX];
+    int64_t last_toggle_ns;
+    int64_t max_toggle_ns;
+};
+
+static struct input_dev input_devs[INPUT_DEV_MAX];
+static pthread_mutex_t input_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t input_uevent_thread;
+static bool input_registry_ready;
+/* Last state applied, so hotplugged devices can be brought in line. */
+static int input_state = 1;
+
+static void read_input_name(int id, char *name, size_t size)
+{
+    char path[80];
+    char real_path[PATH_MAX];
+    ssize_t len;
+    int fd;
+
+    snprintf(name, size, "input%d", id);
+
+    snprintf(path, sizeof(path), INPUT_CLASS_PATH "/input%d/name", id);
+    fd = open(sysfs_path(path, real_path, sizeof(real_path)), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    len = read(fd, name, size - 1);
+    close(fd);
+    if (len <= 0) {
+        snprintf(name, size, "input%d", id);
+        return;
+    }
+
+    name[len] = '\0';
+    if (name[len - 1] == '\n')
+        name[len - 1] = '\0';
+}
+
+/* Must be called with input_lock held. */
+static void write_input_state(struct input_dev *dev, int on)
+{
+    char buf[80];
+    int64_t start = now_ns();
+
+    if (pwrite(dev->fd, on ? "1" : "0", 1, 0) < 0) {
+        /*
+         * The device is gone but its remove uevent has not arrived yet.
+         * Drop it now; an add uevent for the same id tracks it afresh.
+         */
+        if (errno == ENODEV || errno == ENOENT) {
+            ALOGI("Dropping input device:%d (%s), gone", dev->id, dev->name);
+            close(dev->fd);
+            dev->used = false;
+            return;
+        }
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error writing to input%d (%s): %s\n", dev->id, dev->name, buf);
+        return;
+    }
+
+    dev->last_toggle_ns = now_ns() - start;
+    if (dev->last_toggle_ns > dev->max_toggle_ns)
+        dev->max_toggle_ns = dev->last_toggle_ns;
+    if (dev->last_toggle_ns > INPUT_SLOW_TOGGLE_NS)
+        ALOGI("Slow %s of input%d (%s): %lld us\n", on ? "enable" : "disable",
+                dev->id, dev->name, (long long) (dev->last_toggle_ns / NSEC_PER_USEC));
+}
+
+/* Must be called with input_lock held. */
+static struct input_dev *find_input_dev(int id)
+{
+    int i;
+
+    for (i = 0; i < INPUT_DEV_MAX; i++) {
+        if (input_devs[i].used && input_devs[i].id == id)
+            return &input_devs[i];
+    }
+
+    return NULL;
+}
+
+/* Must be called with input_lock held. */
+static void add_input_dev(int id, bool sync_state)
+{
+    char path[80];
+    char real_path[PATH_MAX];
+    struct input_dev *dev;
+    int fd, i;
+
+    if (find_input_dev(id))
+        return;
+
+    snprintf(path, sizeof(path), INPUT_CLASS_PATH "/input%d/enabled", id);
+    fd = open(sysfs_path(path, real_path, sizeof(real_path)), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return; /* Device has no enable control. */
+
+    for (i = 0; i < INPUT_DEV_MAX; i++) {
+        if (!input_devs[i].used)
+            break;
+    }
+
+    if (i == INPUT_DEV_MAX) {
+        ALOGE("Too many input devices, not tracking input%d\n", id);
+        close(fd);
+        return;
+    }
+
+    dev = &input_devs[i];
+    memset(dev, 0, sizeof(*dev));
+    dev->used = true;
+    dev->id = id;
+    dev->fd = fd;
+    read_input_name(id, dev->name, sizeof(dev->name));
+    ALOGI("Tracking input device:%d (%s)", id, dev->name);
+
+    if (sync_state && !input_state)
+        write_input_state(dev, input_state);
+}
+
+/* Must be called with input_lock held. */
+static void remove_input_dev(int id)
+{
+    struct input_dev *dev = find_input_dev(id);
+
+    if (!dev)
+        return;
+
+    ALOGI("Dropping input device:%d (%s)", id, dev->name);
+    close(dev->fd);
+    dev->used = false;
+}
+
+/* Returns the N of an ".../inputN" devpath, or -1 for anything else. */
+static int parse_input_devpath(const char *devpath)
+{
+    const char *base = strrchr(devpath, '/');
+    char *end;
+    long id;
+
+    base = base ? base + 1 : devpath;
+    if (strncmp(base, "input", 5) || !base[5])
+        return -1;
+
+    id = strtol(base + 5, &end, 10);
+    if (*end || id < 0)
+        return -1;
+
+    return (int) id;
+}
+
+static void handle_uevent(const char *msg, ssize_t len)
+{
+    const char *end = msg + len;
+    const char *action = NULL;
+    const char *devpath = NULL;
+    const char *subsystem = NULL;
+    int id;
+
+    while (msg < end) {
+        if (!strncmp(msg, "ACTION=", 7))
+            action = msg + 7;
+        else if (!strncmp(msg, "DEVPATH=", 8))
+            devpath = msg + 8;
+        else if (!strncmp(msg, "SUBSYSTEM=", 10))
+            subsystem = msg + 10;
+        msg += strlen(msg) + 1;
+    }
+
+    if (!action || !devpath || !subsystem || strcmp(subsystem, "input"))
+        return;
+
+    id = parse_input_devpath(devpath);
+    if (id < 0)
+        return;
+
+    pthread_mutex_lock(&input_lock);
+    if (!strcmp(action, "add"))
+        add_input_dev(id, true);
+    else if (!strcmp(action, "remove"))
+        remove_input_dev(id);
+    pthread_mutex_unlock(&input_lock);
+}
+
+static void *input_uevent_loop(void *arg)
+{
+    char msg[UEVENT_MSG_LEN + 2];
+    int sock = (int) (intptr_t) arg;
+    ssize_t len;
+
+    for (;;) {
+        len = uevent_kernel_multicast_recv(sock, msg, UEVENT_MSG_LEN);
+        if (len <= 0)
+            continue;
+        if (len >= UEVENT_MSG_LEN)
+            continue; /* Overflow, drop it. */
+
+        msg[len] = '\0';
+        msg[len + 1] = '\0';
+        handle_uevent(msg, len);
+    }
+
+    return NULL;
+}
+
+void input_registry_init(void)
+{
+    char real_path[PATH_MAX];
+    struct dirent *de;
+    DIR *dir;
+    int sock, id;
+
+    pthread_mutex_lock(&input_lock);
+    if (input_registry_ready) {
+        pthread_mutex_unlock(&input_lock);
+        return;
+    }
+
+    /*
+     * Open the uevent socket before scanning so a device appearing in
+     * between is reported rather than missed; add_input_dev() ignores
+     * devices it already knows about.
+     */
+    sock = uevent_open_socket(64 * 1024, true);
+    if (sock < 0)
+        ALOGE("Error opening uevent socket, input hotplug will be missed\n");
+
+    dir = opendir(sysfs_path(INPUT_CLASS_PATH, real_path, sizeof(real_path)));
+    if (dir) {
+        while ((de = readdir(dir))) {
+            id = parse_input_devpath(de->d_name);
+            if (id >= 0)
+                add_input_dev(id, false);
+        }
+        closedir(dir);
+    } else {
+        ALOGE("Error opening %s: %s\n", INPUT_CLASS_PATH, strerror(errno));
+    }
+
+    if (sock >= 0 && pthread_create(&input_uevent_thread, NULL,
+                input_uevent_loop, (void *) (intptr_t) sock)) {
+        ALOGE("Error creating input uevent thread\n");
+        close(sock);
+    }
+
+    input_registry_ready = true;
+    pthread_mutex_unlock(&input_lock);
+}
+
+void input_registry_set_enabled(int on)
+{
+    int i;
+
+    pthread_mutex_lock(&input_lock);
+    input_state = on;
+    for (i = 0; i < INPUT_DEV_MAX; i++) {
+        if (input_devs[i].used)
+            write_input_state(&input_devs[i], on);
+    }
+    pthread_mutex_unlock(&input_lock);
+}
+
+void input_registry_dump(FILE *f)
+{
+    int i;
+
+    pthread_mutex_lock(&input_lock);
+    for (i = 0; i < INPUT_DEV_MAX; i++) {
+        if (!input_devs[i].used)
+            continue;
+        fprintf(f, "input%d (%s): last toggle %lld us, max %lld us\n",
+                input_devs[i].id, input_devs[i].name,
+                (long long) (input_devs[i].last_toggle_ns / NSEC_PER_USEC),
+                (long long) (input_devs[i].max_toggle_ns / NSEC_PER_USEC));
+    }
+    pthread_mutex_unlock(&input_lock);
+}
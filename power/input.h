@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_POWER_INPUT_H
+#define MACALLAN_POWER_INPUT_H
+
+#include <stdio.h>
+
+/*
+ * Registry of input devices exposing an "enabled" sysfs node. Built once
+ * by scanning /sys/class/input and kept up to date from kernel uevents, so
+ * screen transitions are a single pass over already-open descriptors.
+ */
+void input_registry_init(void);
+void input_registry_set_enabled(int on);
+void input_registry_dump(FILE *f);
+
+#endif // MACALLAN_POWER_INPUT_H
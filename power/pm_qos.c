@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define LOG_TAG "Macallan PowerHAL"
+#include <utils/Log.h>
+
+#include "pm_qos.h"
+#include "sysfs.h"
+
+void pm_qos_update(struct pm_qos_request *req, int32_t value)
+{
+    char buf[80];
+    char real_path[PATH_MAX];
+
+    if (value == req->value)
+        return;
+
+    if (req->fd < 0) {
+        /* No request wanted and none held. */
+        if (!value)
+            return;
+        req->fd = open(sysfs_path(req->path, real_path, sizeof(real_path)),
+                O_WRONLY | O_CLOEXEC);
+        if (req->fd < 0) {
+            strerror_r(errno, buf, sizeof(buf));
+            ALOGE("Error opening %s: %s\n", req->path, buf);
+            return;
+        }
+    }
+
+    if (!value) {
+        close(req->fd);
+        req->fd = -1;
+        req->value = 0;
+        return;
+    }
+
+    if (write(req->fd, &value, sizeof(value)) != sizeof(value)) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error writing to %s: %s\n", req->path, buf);
+        return;
+    }
+
+    req->value = value;
+}
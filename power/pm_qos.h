@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_POWER_PM_QOS_H
+#define MACALLAN_POWER_PM_QOS_H
+
+#include <stdint.h>
+
+/*
+ * A request on one of the kernel's PM QoS misc devices. The request lives
+ * as long as the descriptor is open, so it is held open while a value is
+ * in force and closed to drop the request altogether. Not locked; callers
+ * serialise access to each request.
+ */
+struct pm_qos_request {
+    const char *path;
+    int fd;
+    int32_t value;
+};
+
+#define PM_QOS_REQUEST_INIT(p) { .path = (p), .fd = -1, .value = 0 }
+
+/* Set the requested value, or drop the request if value is 0. */
+void pm_qos_update(struct pm_qos_request *req, int32_t value);
+
+#endif // MACALLAN_POWER_PM_QOS_H
@@ -22,163 +22,519 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #define LOG_TAG "Macallan PowerHAL"
 #include <utils/Log.h>
+#include <cutils/properties.h>
  
 #include <hardware/hardware.h>
 #include <hardware/power.h>
 
+#include "boost.h"
+#include "cores.h"
+#include "energy.h"
+#include "input.h"
+#include "profile.h"
+#include "stats.h"
+#include "thermal.h"
+#include "trace.h"
+#include "sysfs.h"
+#include "tunables.h"
+#include "util.h"
+
 #define BOOSTPULSE_PATH "/sys/devices/system/cpu/cpufreq/interactive/boostpulse"
+/* Used until the governor tunables have been loaded. */
+#define DEFAULT_BOOSTPULSE_DURATION_US 30000
 #define NVAVP_BOOST_SCLK_PATH "/sys/devices/platform/host1x/nvavp/boost_sclk"
 #define CPU_MAX_FREQ_PATH "/sys/devices/system/cpu/cpu0/cpufreq/scaling_max_freq"
 #define IO_IS_BUSY_PATH "/sys/devices/system/cpu/cpufreq/interactive/io_is_busy"
-#define LOW_POWER_MAX_FREQ "918000"
-#define NORMAL_MAX_FREQ "1810500"
+#define WAKE_LOCK_PATH "/sys/power/wake_lock"
+#define WAKE_UNLOCK_PATH "/sys/power/wake_unlock"
+#define TRANSITION_WAKE_LOCK "PowerHAL_transition"
+#define STATS_DUMP_PATH "/data/misc/power/stats.txt"
+#define STATS_DUMP_TMP_PATH STATS_DUMP_PATH ".tmp"
+#define STATS_DUMP_PROPERTY "debug.power.dump"
+#define LOW_POWER_MAX_FREQ 918000
+#define NORMAL_MAX_FREQ 1810500
 
 static bool low_power_mode = false;
+static bool screen_on = true;
+
+static int max_cpu_freq = NORMAL_MAX_FREQ;
+static int low_power_max_cpu_freq = LOW_POWER_MAX_FREQ;
+/* Cap last written to scaling_max_freq, 0 if none or the write failed. */
+static int cpu_max_freq_cap;
 
-static char *max_cpu_freq = NORMAL_MAX_FREQ;
-static char *low_power_max_cpu_freq = LOW_POWER_MAX_FREQ;
+#define TRANSITION_NONE -1
 
 struct macallan_power_module {
     struct power_module base;
     pthread_mutex_t lock;
-    int boostpulse_fd;
+    atomic_int boostpulse_fd;
     int boostpulse_warned;
+
+    /*
+     * The governor already holds a boost for boostpulse_duration after each
+     * pulse, so pulses landing inside that window are dropped. All of this
+     * is lock-free once boostpulse_fd is open.
+     */
+    atomic_llong boostpulse_duration_ns;
+    atomic_llong boostpulse_last_ns;
+    atomic_llong boostpulse_second;
+    atomic_uint boostpulse_received;
+    atomic_uint boostpulse_forwarded;
+    /* Totals of the last complete second. */
+    atomic_uint boostpulse_received_last;
+    atomic_uint boostpulse_forwarded_last;
+
+    /*
+     * Screen transitions are handed to a worker thread so setInteractive
+     * returns to the power manager immediately. Only the most recent
+     * requested state is kept: a burst of on/off/on collapses into one.
+     * A wakelock is held from the moment a transition is queued until the
+     * worker has applied it, so the device cannot suspend with the screen
+     * off writes still outstanding.
+     */
+    pthread_mutex_t transition_lock;
+    pthread_cond_t transition_cond;
+    pthread_t transition_thread;
+    bool transition_worker_running;
+    bool transition_wake_lock_held;
+    int transition_pending;
 };
 
-static int sysfs_write(char *path, char *s)
+static int boostpulse_open(struct macallan_power_module *macallan)
 {
     char buf[80];
-    int len;
-    int fd = open(path, O_WRONLY);
+    char real_path[PATH_MAX];
+    int fd = atomic_load_explicit(&macallan->boostpulse_fd, memory_order_acquire);
+
+    if (fd >= 0)
+        return fd;
 
+    pthread_mutex_lock(&macallan->lock);
+
+    fd = atomic_load_explicit(&macallan->boostpulse_fd, memory_order_relaxed);
     if (fd < 0) {
-        strerror_r(errno, buf, sizeof(buf));
-        ALOGE("Error opening %s: %s\n", path, buf);
-        return -1;
+        fd = open(sysfs_path(BOOSTPULSE_PATH, real_path, sizeof(real_path)), O_WRONLY);
+
+        if (fd < 0) {
+            if (!macallan->boostpulse_warned) {
+                strerror_r(errno, buf, sizeof(buf));
+                ALOGE("Error opening %s: %s\n", BOOSTPULSE_PATH, buf);
+                macallan->boostpulse_warned = 1;
+            }
+        } else {
+            atomic_store_explicit(&macallan->boostpulse_fd, fd, memory_order_release);
+        }
     }
 
-    len = write(fd, s, strlen(s));
-    if (len < 0) {
+    pthread_mutex_unlock(&macallan->lock);
+    return fd;
+}
+
+/*
+ * Roll the per-second pulse counters over when a pulse lands in a new
+ * second. Whoever wins the exchange on boostpulse_second reports the
+ * previous window.
+ */
+static void boostpulse_count(struct macallan_power_module *macallan, int64_t now)
+{
+    long long second = now / NSEC_PER_SEC;
+    long long prev = atomic_load_explicit(&macallan->boostpulse_second, memory_order_relaxed);
+    unsigned int received, forwarded;
+
+    if (second != prev && atomic_compare_exchange_strong(&macallan->boostpulse_second,
+                &prev, second)) {
+        received = atomic_exchange(&macallan->boostpulse_received, 0);
+        forwarded = atomic_exchange(&macallan->boostpulse_forwarded, 0);
+        atomic_store(&macallan->boostpulse_received_last, received);
+        atomic_store(&macallan->boostpulse_forwarded_last, forwarded);
+        if (received)
+            ALOGV("boostpulse: %u received, %u forwarded in the last second\n",
+                    received, forwarded);
+    }
+
+    atomic_fetch_add_explicit(&macallan->boostpulse_received, 1, memory_order_relaxed);
+}
+
+static void boostpulse(struct macallan_power_module *macallan)
+{
+    char buf[80];
+    int64_t now = now_ns();
+    long long last;
+    int fd;
+
+    boostpulse_count(macallan, now);
+
+    last = atomic_load_explicit(&macallan->boostpulse_last_ns, memory_order_relaxed);
+    if (now - last < atomic_load_explicit(&macallan->boostpulse_duration_ns,
+                memory_order_relaxed))
+        return;
+    /* Another thread forwarded a pulse in the meantime. */
+    if (!atomic_compare_exchange_strong(&macallan->boostpulse_last_ns, &last, now))
+        return;
+
+    fd = boostpulse_open(macallan);
+    if (fd < 0)
+        return;
+
+    if (write(fd, "1", 1) < 0) {
         strerror_r(errno, buf, sizeof(buf));
-        ALOGE("Error writing to %s: %s\n", path, buf);
-        return -1;
+        ALOGE("Error writing to %s: %s\n", BOOSTPULSE_PATH, buf);
+        return;
     }
 
-    close(fd);
-    return 0;
+    atomic_fetch_add_explicit(&macallan->boostpulse_forwarded, 1, memory_order_relaxed);
+
+    /* Release the memory and GPU floors together with the pulse. */
+    boost_interaction(atomic_load_explicit(&macallan->boostpulse_duration_ns,
+                memory_order_relaxed));
 }
 
-static void toggle_input(int on, const char* state)
+/*
+ * The scaling_max_freq cap for the current screen, low power, sustained
+ * performance and thermal state. Must be called with macallan->lock held.
+ */
+static int cpu_max_freq(void)
 {
-    int i = 0;
-    int ret;
-    char path[80];
-    
-    while(1)
-    {
-        sprintf(path, "/sys/class/input/input%d/enabled", i);
-        ret = access(path, F_OK);
-        if (ret < 0) {
-            ALOGI("Breaked at device id:%d", i);
-            break;
-        }
-        else {
-            if (0 == on) {
-                ALOGI("Disabling input device:%d", i);
-            }
-            else {
-                ALOGI("Enabling input device:%d", i);
-            }
-            sysfs_write(path, state);
-        }
-        i++;
+    int cap = max_cpu_freq;
+    int thermal = thermal_cap();
+
+    if (!screen_on || low_power_mode)
+        cap = low_power_max_cpu_freq;
+    else if (boost_sustained_active())
+        cap = SUSTAINED_MAX_FREQ;
+
+    if (thermal && thermal < cap)
+        cap = thermal;
+
+    return cap;
+}
+
+/*
+ * Write the cap, moving the boost floors out of the way first when it goes
+ * down. Skipped when the cap is unchanged; a failed write forgets the cap
+ * so the next call tries again. Must be called with macallan->lock held.
+ */
+static void update_cpu_max_freq(void)
+{
+    char buf[16];
+    int cap = cpu_max_freq();
+    int err;
+
+    if (cap == cpu_max_freq_cap)
+        return;
+
+    snprintf(buf, sizeof(buf), "%d", cap);
+
+    if (!cpu_max_freq_cap || cap < cpu_max_freq_cap) {
+        boost_set_ceiling(cap);
+        err = sysfs_write(CPU_MAX_FREQ_PATH, buf);
+    } else {
+        err = sysfs_write(CPU_MAX_FREQ_PATH, buf);
+        boost_set_ceiling(cap);
     }
+
+    cpu_max_freq_cap = err ? 0 : cap;
 }
 
-static int boostpulse_open(struct macallan_power_module *macallan)
+/*
+ * Apply the screen and low power state to cores and the CPU cap. The G
+ * cluster must be back before the cap goes up, and LP only makes sense
+ * once the cap is down. Must be called with macallan->lock held.
+ */
+static void update_power_state(void)
 {
-    char buf[80];
-    int len;
+    energy_update(ENERGY_SCREEN_BITS, (screen_on ? ENERGY_SCREEN_ON : 0) |
+            (low_power_mode ? ENERGY_LOW_POWER : 0));
+
+    thermal_set_screen(screen_on);
+
+    if (screen_on) {
+        cores_update(screen_on, low_power_mode);
+        update_cpu_max_freq();
+    } else {
+        update_cpu_max_freq();
+        cores_update(screen_on, low_power_mode);
+    }
+}
+
+static void thermal_cap_changed(void *arg)
+{
+    struct macallan_power_module *macallan = (struct macallan_power_module *) arg;
 
     pthread_mutex_lock(&macallan->lock);
+    update_cpu_max_freq();
+    pthread_mutex_unlock(&macallan->lock);
+}
 
-    if (macallan->boostpulse_fd < 0) {
-        macallan->boostpulse_fd = open(BOOSTPULSE_PATH, O_WRONLY);
+static void update_boostpulse_duration(struct macallan_power_module *macallan)
+{
+    int duration_us = tunables_get_int("boostpulse_duration",
+            DEFAULT_BOOSTPULSE_DURATION_US);
 
-        if (macallan->boostpulse_fd < 0) {
-            if (!macallan->boostpulse_warned) {
-                strerror_r(errno, buf, sizeof(buf));
-                ALOGE("Error opening %s: %s\n", BOOSTPULSE_PATH, buf);
-                macallan->boostpulse_warned = 1;
-            }
-        }
+    atomic_store(&macallan->boostpulse_duration_ns, duration_us * NSEC_PER_USEC);
+}
+
+static bool transition_superseded(struct macallan_power_module *macallan)
+{
+    bool superseded;
+
+    pthread_mutex_lock(&macallan->transition_lock);
+    superseded = macallan->transition_pending != TRANSITION_NONE;
+    pthread_mutex_unlock(&macallan->transition_lock);
+
+    return superseded;
+}
+
+/*
+ * Write out everything we count to STATS_DUMP_PATH, and the hint trace
+ * to TRACE_DUMP_PATH. The legacy power HAL has no dump entry point, so
+ * setting STATS_DUMP_PROPERTY to 1 asks for a dump at the next screen
+ * transition; it is set back to 0 once written. rename() keeps readers
+ * from seeing a partial file.
+ */
+static void dump_stats_if_requested(struct macallan_power_module *macallan)
+{
+    char value[PROPERTY_VALUE_MAX];
+    FILE *f;
+
+    property_get(STATS_DUMP_PROPERTY, value, "0");
+    if (strcmp(value, "1"))
+        return;
+    property_set(STATS_DUMP_PROPERTY, "0");
+
+    f = fopen(STATS_DUMP_TMP_PATH, "w");
+
+    if (!f) {
+        ALOGV("Error opening %s: %s\n", STATS_DUMP_TMP_PATH, strerror(errno));
+        return;
     }
 
+    fprintf(f, "boostpulse: %u received, %u forwarded in the last second\n",
+            atomic_load(&macallan->boostpulse_received_last),
+            atomic_load(&macallan->boostpulse_forwarded_last));
+    stats_dump(f);
+    energy_dump(f);
+    sysfs_dump(f);
+    input_registry_dump(f);
+
+    fclose(f);
+    trace_dump(TRACE_DUMP_PATH);
+    if (rename(STATS_DUMP_TMP_PATH, STATS_DUMP_PATH))
+        ALOGE("Error renaming %s: %s\n", STATS_DUMP_TMP_PATH, strerror(errno));
+}
+
+/*
+ * Apply a screen transition, most latency-critical writes first. If a newer
+ * transition is queued while we are working, the remaining steps are
+ * skipped since the worker is about to apply the newer state anyway.
+ */
+static void apply_interactive_steps(struct macallan_power_module *macallan, int on)
+{
+    const char* state = (0 == on)?"0":"1";
+
+    pthread_mutex_lock(&macallan->lock);
+    screen_on = on;
+    /*
+     * Lower maximum frequency and move to the LP core when screen is off.
+     */
+    update_power_state();
     pthread_mutex_unlock(&macallan->lock);
-    return macallan->boostpulse_fd;
+    sysfs_write(NVAVP_BOOST_SCLK_PATH, state);
+    if (transition_superseded(macallan))
+        return;
+
+    sysfs_write(IO_IS_BUSY_PATH, state);
+    if (transition_superseded(macallan))
+        return;
+
+    input_registry_set_enabled(on);
+}
+
+static void apply_interactive(struct macallan_power_module *macallan, int on)
+{
+    int64_t start = now_ns();
+
+    /* Pick up governor tunables edited since the last screen on. */
+    if (on && tunables_reload_if_changed())
+        update_boostpulse_duration(macallan);
+
+    /* Close the energy window on the state we are leaving. */
+    energy_sample();
+
+    apply_interactive_steps(macallan, on);
+    stats_record(STATS_TRANSITION, now_ns() - start);
+    dump_stats_if_requested(macallan);
+}
+
+static void *transition_worker(void *arg)
+{
+    struct macallan_power_module *macallan = (struct macallan_power_module *) arg;
+    int on;
+
+    for (;;) {
+        pthread_mutex_lock(&macallan->transition_lock);
+        while (macallan->transition_pending == TRANSITION_NONE)
+            pthread_cond_wait(&macallan->transition_cond, &macallan->transition_lock);
+        on = macallan->transition_pending;
+        macallan->transition_pending = TRANSITION_NONE;
+        pthread_mutex_unlock(&macallan->transition_lock);
+
+        apply_interactive(macallan, on);
+
+        pthread_mutex_lock(&macallan->transition_lock);
+        if (macallan->transition_pending == TRANSITION_NONE &&
+                macallan->transition_wake_lock_held) {
+            sysfs_write(WAKE_UNLOCK_PATH, TRANSITION_WAKE_LOCK);
+            macallan->transition_wake_lock_held = false;
+        }
+        pthread_mutex_unlock(&macallan->transition_lock);
+    }
+
+    return NULL;
+}
+
+static void transition_worker_start(struct macallan_power_module *macallan)
+{
+    int ret;
+
+    pthread_mutex_lock(&macallan->transition_lock);
+    if (!macallan->transition_worker_running) {
+        ret = pthread_create(&macallan->transition_thread, NULL,
+                transition_worker, macallan);
+        if (ret)
+            ALOGE("Error creating transition worker: %s\n", strerror(ret));
+        else
+            macallan->transition_worker_running = true;
+    }
+    pthread_mutex_unlock(&macallan->transition_lock);
 }
 
 static void macallan_power_init(struct power_module *module)
 {
-    sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/timer_rate","20000");
-    sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/timer_slack","80000");
-    sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/min_sample_time","90000");
-    sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/hispeed_freq","1224000");
-    sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/go_hispeed_load","99");
-    sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/target_loads","75 228000:85 696000:90 1530000:95");
-    sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/above_hispeed_delay","20000 1530000:50000");
-    sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/boostpulse_duration","30000");
+    struct macallan_power_module *macallan = (struct macallan_power_module *) module;
+
     sysfs_write("/sys/devices/system/cpu/cpufreq/interactive/io_is_busy", "0");
+
+    trace_init();
+    energy_init();
+    boost_init();
+    cores_init();
+    tunables_init();
+    update_boostpulse_duration(macallan);
+    thermal_init(thermal_cap_changed, macallan);
+    profile_init();
+    input_registry_init();
+    transition_worker_start(macallan);
 }
 
 static void macallan_power_set_interactive(struct power_module *module, int on)
 {
-    const char* state = (0 == on)?"0":"1";
-    
-    sysfs_write(NVAVP_BOOST_SCLK_PATH, state);
-    /*
-     * Lower maximum frequency when screen is off.
-     */
-    sysfs_write(CPU_MAX_FREQ_PATH,(!on || low_power_mode) ? low_power_max_cpu_freq : max_cpu_freq);
-    sysfs_write(IO_IS_BUSY_PATH, state);
-    toggle_input(on, state);
+    struct macallan_power_module *macallan = (struct macallan_power_module *) module;
+    int64_t start = now_ns();
+
+    trace_record(TRACE_SET_INTERACTIVE, on);
+
+    pthread_mutex_lock(&macallan->transition_lock);
+    if (macallan->transition_worker_running) {
+        if (!macallan->transition_wake_lock_held) {
+            sysfs_write(WAKE_LOCK_PATH, TRANSITION_WAKE_LOCK);
+            macallan->transition_wake_lock_held = true;
+        }
+        macallan->transition_pending = on ? 1 : 0;
+        pthread_cond_signal(&macallan->transition_cond);
+        pthread_mutex_unlock(&macallan->transition_lock);
+    } else {
+        pthread_mutex_unlock(&macallan->transition_lock);
+        /* No worker (thread creation failed); fall back to applying inline. */
+        apply_interactive(macallan, on);
+    }
+
+    stats_record(STATS_SET_INTERACTIVE, now_ns() - start);
+}
+
+static enum stats_id hint_stats_id(power_hint_t hint)
+{
+    switch (hint) {
+        case POWER_HINT_VSYNC:
+            return STATS_HINT_VSYNC;
+        case POWER_HINT_INTERACTION:
+            return STATS_HINT_INTERACTION;
+        case POWER_HINT_VIDEO_ENCODE:
+            return STATS_HINT_VIDEO_ENCODE;
+        case POWER_HINT_VIDEO_DECODE:
+            return STATS_HINT_VIDEO_DECODE;
+        case POWER_HINT_LOW_POWER:
+            return STATS_HINT_LOW_POWER;
+        case POWER_HINT_SUSTAINED_PERFORMANCE:
+            return STATS_HINT_SUSTAINED_PERFORMANCE;
+        case POWER_HINT_VR_MODE:
+            return STATS_HINT_VR_MODE;
+        case POWER_HINT_LAUNCH:
+            return STATS_HINT_LAUNCH;
+        case POWER_HINT_SET_PROFILE:
+            return STATS_HINT_SET_PROFILE;
+        default:
+            return STATS_HINT_OTHER;
+    }
 }
 
 static void macallan_power_hint(struct power_module *module, power_hint_t hint, void *data)
 {
     struct macallan_power_module *macallan = (struct macallan_power_module *) module;
-    char buf[80];
-    int len;
-    
+    int64_t start = now_ns();
+
+    if (hint == POWER_HINT_SET_PROFILE)
+        trace_record(hint, data ? *(int32_t *) data : 0);
+    else
+        trace_record(hint, data != NULL);
+
     switch (hint) {
         case POWER_HINT_VSYNC:
+            boost_vsync(data != NULL);
             break;
         case POWER_HINT_INTERACTION:
-            if (boostpulse_open(macallan) >= 0) {
-                len = write(macallan->boostpulse_fd, "1", 1);
-
-                if (len < 0) {
-                    strerror_r(errno, buf, sizeof(buf));
-                    ALOGE("Error writing to %s: %s\n", BOOSTPULSE_PATH, buf);
-                }
-            }
+            boostpulse(macallan);
+            break;
+        case POWER_HINT_LAUNCH:
+            pthread_mutex_lock(&macallan->lock);
+            /* No point raising the floor against the low power cap. */
+            if (!data || (screen_on && !low_power_mode))
+                boost_launch(data != NULL);
+            pthread_mutex_unlock(&macallan->lock);
+            break;
+        case POWER_HINT_SUSTAINED_PERFORMANCE:
+            pthread_mutex_lock(&macallan->lock);
+            boost_sustained(data != NULL);
+            update_cpu_max_freq();
+            pthread_mutex_unlock(&macallan->lock);
             break;
         case POWER_HINT_LOW_POWER:
             pthread_mutex_lock(&macallan->lock);
-            if (data) {
-                sysfs_write(CPU_MAX_FREQ_PATH, low_power_max_cpu_freq);
-            } else {
-                sysfs_write(CPU_MAX_FREQ_PATH, max_cpu_freq);
-            }
             low_power_mode = data;
+            update_power_state();
             pthread_mutex_unlock(&macallan->lock);
             break;
+        case POWER_HINT_SET_PROFILE:
+            if (data)
+                profile_apply(*(int32_t *) data);
+            break;
         default:
             break;
     }
+
+    stats_record(hint_stats_id(hint), now_ns() - start);
+}
+
+static int macallan_power_get_feature(struct power_module *module, feature_t feature)
+{
+    if (feature == POWER_FEATURE_SUPPORTED_PROFILES)
+        return PROFILE_MAX;
+    return -1;
 }
 
 static struct hw_module_methods_t power_module_methods = {
@@ -200,8 +556,15 @@ struct macallan_power_module HAL_MODULE_INFO_SYM = {
         .init = macallan_power_init,
         .setInteractive = macallan_power_set_interactive,
         .powerHint = macallan_power_hint,
+        .getFeature = macallan_power_get_feature,
     },
     lock: PTHREAD_MUTEX_INITIALIZER,
     boostpulse_fd: -1,
+    boostpulse_duration_ns: DEFAULT_BOOSTPULSE_DURATION_US * NSEC_PER_USEC,
     boostpulse_warned: 0,
+    transition_lock: PTHREAD_MUTEX_INITIALIZER,
+    transition_cond: PTHREAD_COND_INITIALIZER,
+    transition_worker_running: false,
+    transition_wake_lock_held: false,
+    transition_pending: TRANSITION_NONE,
 };
\ No newline at end of file
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define LOG_TAG "Macallan PowerHAL"
+#include <utils/Log.h>
+#include <cutils/properties.h>
+
+#include "profile.h"
+#include "sysfs.h"
+
+#define PROFILE_CONFIG_PATH "/system/etc/power.macallan.rc"
+#define PANEL_MODES_PATH "/sys/class/graphics/fb0/modes"
+#define PROFILE_NODE_MAX 16
+#define PROFILE_NODE_LEN 128
+#define PROFILE_VALUE_LEN 16
+
+/* Bare names in the config are NVIDIA tunables kept in system properties. */
+#define PROFILE_PROP_PREFIX "persist.sys."
+
+/*
+ * Column order in power.macallan.rc: normal, balanced, maxbatterylife.
+ * Indexed by profile to find the matching column.
+ */
+static const int profile_column[PROFILE_MAX] = {
+    [PROFILE_POWER_SAVE] = 2,
+    [PROFILE_BALANCED] = 1,
+    [PROFILE_HIGH_PERFORMANCE] = 0,
+};
+
+struct profile_node {
+    char node[PROFILE_NODE_LEN];
+    bool is_path;
+    char value[3][PROFILE_VALUE_LEN];
+};
+
+struct profile_table {
+    int count;
+    struct profile_node nodes[PROFILE_NODE_MAX];
+};
+
+static struct profile_table profile_nodes;
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+static int current_profile = -1;
+
+static bool read_panel_resolution(int *xres, int *yres)
+{
+    char line[80];
+    char real_path[PATH_MAX];
+    FILE *f = fopen(sysfs_path(PANEL_MODES_PATH, real_path, sizeof(real_path)), "r");
+    bool found = false;
+
+    if (!f) {
+        ALOGE("Error opening %s: %s\n", PANEL_MODES_PATH, strerror(errno));
+        return false;
+    }
+
+    /* First line is the active mode, e.g. "U:2560x1600p-60". */
+    if (fgets(line, sizeof(line), f))
+        found = sscanf(line, "%*[^:]:%dx%d", xres, yres) == 2;
+
+    fclose(f);
+    return found;
+}
+
+static void parse_node_line(struct profile_table *table, const char *line)
+{
+    struct profile_node *node;
+
+    if (table->count == PROFILE_NODE_MAX) {
+        ALOGE("Too many power profile nodes, ignoring: %s\n", line);
+        return;
+    }
+
+    node = &table->nodes[table->count];
+    if (sscanf(line, "%127s %15s %15s %15s", node->node, node->value[0],
+                node->value[1], node->value[2]) != 4) {
+        ALOGE("Malformed power profile line: %s\n", line);
+        return;
+    }
+
+    node->is_path = node->node[0] == '/';
+    table->count++;
+}
+
+static void parse_config(int xres, int yres)
+{
+    struct profile_table defaults;
+    struct profile_table *target = NULL;
+    bool have_match = false;
+    char line[256];
+    int x, y;
+    FILE *f;
+
+    f = fopen(PROFILE_CONFIG_PATH, "r");
+    if (!f) {
+        ALOGE("Error opening %s: %s\n", PROFILE_CONFIG_PATH, strerror(errno));
+        return;
+    }
+
+    memset(&defaults, 0, sizeof(defaults));
+    memset(&profile_nodes, 0, sizeof(profile_nodes));
+
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0')
+            continue;
+
+        if (sscanf(line, "panelresolution=%dX%d", &x, &y) == 2) {
+            if (x == -1 && y == -1) {
+                target = &defaults;
+            } else if (!have_match && ((x == xres && y == yres) ||
+                        (x == yres && y == xres))) {
+                target = &profile_nodes;
+                have_match = true;
+            } else {
+                target = NULL;
+            }
+            continue;
+        }
+
+        if (target)
+            parse_node_line(target, line);
+    }
+
+    fclose(f);
+
+    if (!have_match)
+        profile_nodes = defaults;
+
+    ALOGI("Loaded %d power profile nodes for %s panel\n", profile_nodes.count,
+            have_match ? "matching" : "default");
+}
+
+static void apply_property(const char *name, const char *value)
+{
+    char key[PROPERTY_KEY_MAX];
+    char cur[PROPERTY_VALUE_MAX];
+
+    snprintf(key, sizeof(key), PROFILE_PROP_PREFIX "%s", name);
+
+    /* Persistent properties hit /data on every set, so skip no-ops. */
+    property_get(key, cur, "");
+    if (!strcmp(cur, value))
+        return;
+
+    if (property_set(key, value))
+        ALOGE("Error setting %s to %s\n", key, value);
+}
+
+void profile_init(void)
+{
+    int xres = -1, yres = -1;
+
+    if (!read_panel_resolution(&xres, &yres))
+        ALOGW("Unknown panel resolution, using default power profile\n");
+
+    pthread_mutex_lock(&profile_lock);
+    parse_config(xres, yres);
+    pthread_mutex_unlock(&profile_lock);
+}
+
+int profile_apply(int profile)
+{
+    struct profile_node *node;
+    int column, i;
+
+    if (profile < 0 || profile >= PROFILE_MAX)
+        return -EINVAL;
+
+    column = profile_column[profile];
+
+    pthread_mutex_lock(&profile_lock);
+    if (profile == current_profile) {
+        pthread_mutex_unlock(&profile_lock);
+        return 0;
+    }
+
+    for (i = 0; i < profile_nodes.count; i++) {
+        node = &profile_nodes.nodes[i];
+        if (node->is_path)
+            sysfs_write(node->node, node->value[column]);
+        else
+            apply_property(node->node, node->value[column]);
+    }
+
+    current_profile = profile;
+    pthread_mutex_unlock(&profile_lock);
+
+    ALOGI("Applied power profile %d\n", profile);
+    return 0;
+}
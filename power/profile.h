@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_POWER_PROFILE_H
+#define MACALLAN_POWER_PROFILE_H
+
+/* Profiles as numbered by POWER_HINT_SET_PROFILE. */
+enum {
+    PROFILE_POWER_SAVE = 0,
+    PROFILE_BALANCED,
+    PROFILE_HIGH_PERFORMANCE,
+    PROFILE_MAX
+};
+
+/*
+ * Parse power.macallan.rc once and keep the settings for the detected
+ * panel resolution (or the -1X-1 defaults) for later profile switches.
+ */
+void profile_init(void);
+
+/* Apply every setting of a profile in one pass. */
+int profile_apply(int profile);
+
+#endif // MACALLAN_POWER_PROFILE_H
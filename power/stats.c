@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "stats.h"
+#include "util.h"
+
+static struct stats_hist stats[STATS_MAX];
+
+static const char *const stats_names[STATS_MAX] = {
+    [STATS_SET_INTERACTIVE] = "setInteractive",
+    [STATS_TRANSITION] = "screen transition",
+    [STATS_HINT_VSYNC] = "hint VSYNC",
+    [STATS_HINT_INTERACTION] = "hint INTERACTION",
+    [STATS_HINT_VIDEO_ENCODE] = "hint VIDEO_ENCODE",
+    [STATS_HINT_VIDEO_DECODE] = "hint VIDEO_DECODE",
+    [STATS_HINT_LOW_POWER] = "hint LOW_POWER",
+    [STATS_HINT_SUSTAINED_PERFORMANCE] = "hint SUSTAINED_PERFORMANCE",
+    [STATS_HINT_VR_MODE] = "hint VR_MODE",
+    [STATS_HINT_LAUNCH] = "hint LAUNCH",
+    [STATS_HINT_SET_PROFILE] = "hint SET_PROFILE",
+    [STATS_HINT_OTHER] = "hint other",
+    [STATS_SYSFS_WRITE] = "sysfs write",
+};
+
+static int log2_bucket(uint64_t ns)
+{
+    int bucket = 0;
+
+    while (ns >>= 1)
+        bucket++;
+
+    return bucket < STATS_BUCKETS ? bucket : STATS_BUCKETS - 1;
+}
+
+void stats_hist_record(struct stats_hist *hist, int64_t ns)
+{
+    unsigned long long max;
+
+    if (ns < 0)
+        ns = 0;
+
+    atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->total_ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->buckets[log2_bucket(ns)], 1, memory_order_relaxed);
+
+    max = atomic_load_explicit(&hist->max_ns, memory_order_relaxed);
+    while ((unsigned long long) ns > max &&
+            !atomic_compare_exchange_weak_explicit(&hist->max_ns, &max, ns,
+                memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+static void print_duration(FILE *f, uint64_t ns)
+{
+    if (ns < NSEC_PER_USEC)
+        fprintf(f, "%llu ns", (unsigned long long) ns);
+    else if (ns < NSEC_PER_MSEC)
+        fprintf(f, "%llu us", (unsigned long long) (ns / NSEC_PER_USEC));
+    else
+        fprintf(f, "%llu ms", (unsigned long long) (ns / NSEC_PER_MSEC));
+}
+
+void stats_hist_dump(FILE *f, const char *name, struct stats_hist *hist)
+{
+    unsigned int count = atomic_load_explicit(&hist->count, memory_order_relaxed);
+    unsigned long long total = atomic_load_explicit(&hist->total_ns, memory_order_relaxed);
+    unsigned int n;
+    int i;
+
+    if (!count)
+        return;
+
+    fprintf(f, "%s: %u calls, avg ", name, count);
+    print_duration(f, total / count);
+    fprintf(f, ", max ");
+    print_duration(f, atomic_load_explicit(&hist->max_ns, memory_order_relaxed));
+    fprintf(f, "\n");
+
+    for (i = 0; i < STATS_BUCKETS; i++) {
+        n = atomic_load_explicit(&hist->buckets[i], memory_order_relaxed);
+        if (!n)
+            continue;
+        fprintf(f, "    [");
+        print_duration(f, 1ULL << i);
+        fprintf(f, ", ");
+        print_duration(f, 2ULL << i);
+        fprintf(f, "): %u\n", n);
+    }
+}
+
+void stats_record(enum stats_id id, int64_t ns)
+{
+    stats_hist_record(&stats[id], ns);
+}
+
+void stats_dump(FILE *f)
+{
+    int i;
+
+    for (i = 0; i < STATS_MAX; i++)
+        stats_hist_dump(f, stats_names[i], &stats[i]);
+}
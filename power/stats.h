@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_POWER_STATS_H
+#define MACALLAN_POWER_STATS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Call counts and log2 latency histograms. Recording is a handful of
+ * relaxed atomic adds, so it is safe on the hint fast paths and never
+ * contends with them. Bucket i counts calls taking [2^i, 2^(i+1)) ns.
+ */
+#define STATS_BUCKETS 32
+
+struct stats_hist {
+    atomic_uint count;
+    atomic_ullong total_ns;
+    atomic_ullong max_ns;
+    atomic_uint buckets[STATS_BUCKETS];
+};
+
+enum stats_id {
+    STATS_SET_INTERACTIVE,
+    STATS_TRANSITION,
+    STATS_HINT_VSYNC,
+    STATS_HINT_INTERACTION,
+    STATS_HINT_VIDEO_ENCODE,
+    STATS_HINT_VIDEO_DECODE,
+    STATS_HINT_LOW_POWER,
+    STATS_HINT_SUSTAINED_PERFORMANCE,
+    STATS_HINT_VR_MODE,
+    STATS_HINT_LAUNCH,
+    STATS_HINT_SET_PROFILE,
+    STATS_HINT_OTHER,
+    STATS_SYSFS_WRITE,
+    STATS_MAX
+};
+
+void stats_hist_record(struct stats_hist *hist, int64_t ns);
+void stats_hist_dump(FILE *f, const char *name, struct stats_hist *hist);
+
+void stats_record(enum stats_id id, int64_t ns);
+void stats_dump(FILE *f);
+
+#endif // MACALLAN_POWER_STATS_H
@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define LOG_TAG "Macallan PowerHAL"
+#include <utils/Log.h>
+
+#include "stats.h"
+#include "sysfs.h"
+#include "util.h"
+
+/*
+ * Cache of sysfs descriptors, keyed by path. Tunables are written over and
+ * over on every screen transition, so keep them open and rewrite in place
+ * instead of paying for a path lookup each time.
+ */
+#define SYSFS_PATH_MAX 128
+#define SYSFS_NODE_MAX 48
+#define SYSFS_VALUE_MAX 64
+
+/*
+ * Interactive governor tunables are only ever written by us, so for those
+ * nodes the last value successfully written is shadowed and rewriting
+ * the value a tunable already holds costs nothing. Other nodes, such as
+ * scaling_min_freq, scaling_max_freq or cluster/active, are also changed
+ * by the kernel, and are always written.
+ *
+ * sysfs_lock only guards the table itself. Each node has a lock of its
+ * own held across the write, so a slow node (cpufreq, cluster/active)
+ * does not hold up writes to the others. Entries are never removed, so a
+ * node stays valid once looked up.
+ */
+struct sysfs_node {
+    char path[SYSFS_PATH_MAX];
+    pthread_mutex_t lock;
+    int fd;
+    bool elide;
+    bool shadow_valid;
+    char shadow[SYSFS_VALUE_MAX];
+    struct stats_hist write_stats;
+};
+
+static struct sysfs_node sysfs_nodes[SYSFS_NODE_MAX];
+static int sysfs_node_count;
+static bool sysfs_nodes_full_warned;
+static atomic_uint sysfs_writes_issued;
+static atomic_uint sysfs_writes_elided;
+static pthread_mutex_t sysfs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define GOVERNOR_TUNABLES_DIR "/sys/devices/system/cpu/cpufreq/interactive/"
+
+#define SYSFS_ROOT_ENV "MACALLAN_SYSFS_ROOT"
+
+static pthread_once_t sysfs_root_once = PTHREAD_ONCE_INIT;
+static const char *sysfs_root = "";
+
+static void sysfs_root_init(void)
+{
+    const char *root = getenv(SYSFS_ROOT_ENV);
+
+    if (root && root[0]) {
+        sysfs_root = root;
+        ALOGI("Using sysfs root %s\n", sysfs_root);
+    }
+}
+
+const char *sysfs_path(const char *path, char *buf, size_t size)
+{
+    pthread_once(&sysfs_root_once, sysfs_root_init);
+
+    if (!sysfs_root[0])
+        return path;
+
+    snprintf(buf, size, "%s%s", sysfs_root, path);
+    return buf;
+}
+
+/* Must be called with sysfs_lock held. Returns NULL if the table is full. */
+static struct sysfs_node *sysfs_node_get(const char *path)
+{
+    struct sysfs_node *node;
+    int i;
+
+    for (i = 0; i < sysfs_node_count; i++) {
+        if (!strcmp(sysfs_nodes[i].path, path))
+            return &sysfs_nodes[i];
+    }
+
+    if (strlen(path) >= SYSFS_PATH_MAX)
+        return NULL;
+
+    if (sysfs_node_count == SYSFS_NODE_MAX) {
+        if (!sysfs_nodes_full_warned) {
+            ALOGW("sysfs node cache full, writing %s and later nodes uncached\n", path);
+            sysfs_nodes_full_warned = true;
+        }
+        return NULL;
+    }
+
+    node = &sysfs_nodes[sysfs_node_count++];
+    strcpy(node->path, path);
+    pthread_mutex_init(&node->lock, NULL);
+    node->fd = -1;
+    node->elide = !strncmp(path, GOVERNOR_TUNABLES_DIR, strlen(GOVERNOR_TUNABLES_DIR));
+    node->shadow_valid = false;
+    memset(&node->write_stats, 0, sizeof(node->write_stats));
+    return node;
+}
+
+static int sysfs_write_uncached(const char *path, const char *s)
+{
+    char buf[80];
+    char real_path[PATH_MAX];
+    int len;
+    int fd = open(sysfs_path(path, real_path, sizeof(real_path)), O_WRONLY);
+
+    if (fd < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error opening %s: %s\n", path, buf);
+        return -1;
+    }
+
+    len = write(fd, s, strlen(s));
+    if (len < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error writing to %s: %s\n", path, buf);
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+int sysfs_write(const char *path, const char *s)
+{
+    char buf[80];
+    char real_path[PATH_MAX];
+    struct sysfs_node *node;
+    size_t size = strlen(s);
+    int64_t start, elapsed;
+    int retried = 0;
+    int len;
+
+    pthread_mutex_lock(&sysfs_lock);
+    node = sysfs_node_get(path);
+    pthread_mutex_unlock(&sysfs_lock);
+
+    if (!node) {
+        atomic_fetch_add(&sysfs_writes_issued, 1);
+        return sysfs_write_uncached(path, s);
+    }
+
+    pthread_mutex_lock(&node->lock);
+
+    if (node->elide && node->shadow_valid && !strcmp(node->shadow, s)) {
+        atomic_fetch_add(&sysfs_writes_elided, 1);
+        pthread_mutex_unlock(&node->lock);
+        return 0;
+    }
+
+    start = now_ns();
+    for (;;) {
+        if (node->fd < 0) {
+            node->fd = open(sysfs_path(node->path, real_path, sizeof(real_path)),
+                    O_WRONLY | O_CLOEXEC);
+            if (node->fd < 0) {
+                strerror_r(errno, buf, sizeof(buf));
+                ALOGE("Error opening %s: %s\n", path, buf);
+                pthread_mutex_unlock(&node->lock);
+                return -1;
+            }
+        }
+
+        len = pwrite(node->fd, s, size, 0);
+        if (len >= 0)
+            break;
+
+        /*
+         * The node went away under us (driver reload, input device
+         * unplugged). Drop the stale descriptor and try a fresh open once.
+         */
+        if ((errno == ENODEV || errno == EBADF) && !retried) {
+            close(node->fd);
+            node->fd = -1;
+            retried = 1;
+            continue;
+        }
+
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error writing to %s: %s\n", path, buf);
+        node->shadow_valid = false;
+        pthread_mutex_unlock(&node->lock);
+        return -1;
+    }
+
+    elapsed = now_ns() - start;
+    stats_hist_record(&node->write_stats, elapsed);
+    stats_record(STATS_SYSFS_WRITE, elapsed);
+
+    atomic_fetch_add(&sysfs_writes_issued, 1);
+    node->shadow_valid = size < SYSFS_VALUE_MAX;
+    if (node->shadow_valid)
+        memcpy(node->shadow, s, size + 1);
+
+    pthread_mutex_unlock(&node->lock);
+    return 0;
+}
+
+int sysfs_read(const char *path, char *s, size_t size)
+{
+    char buf[80];
+    char real_path[PATH_MAX];
+    ssize_t len;
+    int fd = open(sysfs_path(path, real_path, sizeof(real_path)), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error opening %s: %s\n", path, buf);
+        return -1;
+    }
+
+    len = read(fd, s, size - 1);
+    if (len < 0) {
+        strerror_r(errno, buf, sizeof(buf));
+        ALOGE("Error reading from %s: %s\n", path, buf);
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+
+    s[len] = '\0';
+    if (len > 0 && s[len - 1] == '\n')
+        s[len - 1] = '\0';
+    return 0;
+}
+
+void sysfs_dump(FILE *f)
+{
+    int count, i;
+
+    pthread_mutex_lock(&sysfs_lock);
+    count = sysfs_node_count;
+    pthread_mutex_unlock(&sysfs_lock);
+
+    fprintf(f, "sysfs writes: %u issued, %u elided\n", atomic_load(&sysfs_writes_issued),
+            atomic_load(&sysfs_writes_elided));
+    for (i = 0; i < count; i++) {
+        pthread_mutex_lock(&sysfs_nodes[i].lock);
+        stats_hist_dump(f, sysfs_nodes[i].path, &sysfs_nodes[i].write_stats);
+        pthread_mutex_unlock(&sysfs_nodes[i].lock);
+    }
+}
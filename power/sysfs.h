@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_POWER_SYSFS_H
+#define MACALLAN_POWER_SYSFS_H
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Write a string to a sysfs node through the descriptor cache. For
+ * interactive governor tunables, writes of the value the node already
+ * holds are skipped.
+ */
+int sysfs_write(const char *path, const char *s);
+
+/* Read a sysfs node into s, dropping the trailing newline. Not cached. */
+int sysfs_read(const char *path, char *s, size_t size);
+
+/* Write counts and per-node write latency histograms. */
+void sysfs_dump(FILE *f);
+
+/*
+ * Resolve an absolute /sys path against the root prefix taken from the
+ * MACALLAN_SYSFS_ROOT environment variable, so the HAL can be pointed at
+ * a fake tree off-device. Returns path itself when no prefix is set,
+ * otherwise the prefixed path in buf.
+ */
+const char *sysfs_path(const char *path, char *buf, size_t size);
+
+#endif // MACALLAN_POWER_SYSFS_H
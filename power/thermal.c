@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#define LOG_TAG "Macallan PowerHAL"
+#include <utils/Log.h>
+
+#include "sysfs.h"
+#include "thermal.h"
+
+#define THERMAL_CONFIG_PATH "/system/etc/power_thermal.conf"
+#define THERMAL_CLASS_PATH "/sys/class/thermal"
+#define THERMAL_ZONE_MAX 16
+#define THERMAL_TRIP_MAX 8
+#define THERMAL_TYPE_LEN 32
+#define THERMAL_POLL_MS 1000
+
+struct thermal_trip {
+    int temp;       /* millidegrees C at which this trip engages */
+    int clear;      /* millidegrees C below which it disengages */
+    int max_freq;   /* kHz */
+};
+
+struct thermal_zone {
+    int fd;
+    char type[THERMAL_TYPE_LEN];
+};
+
+static struct thermal_trip trips[THERMAL_TRIP_MAX];
+static int trip_count;
+
+/* Zone types to watch; every zone when none are configured. */
+static char zone_types[THERMAL_ZONE_MAX][THERMAL_TYPE_LEN];
+static int zone_type_count;
+
+static struct thermal_zone zones[THERMAL_ZONE_MAX];
+static int zone_count;
+
+/* Number of trips currently engaged; trips[level - 1] sets the cap. */
+static int level;
+static atomic_int current_cap;
+
+static void (*cap_changed_cb)(void *arg);
+static void *cap_changed_arg;
+static pthread_t thermal_thread;
+
+/*
+ * Sampling stops with the screen off, where the CPU is held at the low
+ * power cap, rather than waking it every second.
+ */
+static int thermal_timer_fd = -1;
+static bool thermal_polling;
+static pthread_mutex_t thermal_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int compare_trips(const void *a, const void *b)
+{
+    return ((const struct thermal_trip *) a)->temp -
+            ((const struct thermal_trip *) b)->temp;
+}
+
+static bool load_config(void)
+{
+    struct thermal_trip *trip;
+    char line[128];
+    FILE *f;
+
+    f = fopen(THERMAL_CONFIG_PATH, "r");
+    if (!f) {
+        ALOGI("No %s, thermal capping disabled\n", THERMAL_CONFIG_PATH);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        if (!strncmp(line, "zone ", 5)) {
+            if (zone_type_count < THERMAL_ZONE_MAX &&
+                    sscanf(line + 5, "%31s", zone_types[zone_type_count]) == 1)
+                zone_type_count++;
+            continue;
+        }
+
+        if (!strncmp(line, "trip ", 5) && trip_count < THERMAL_TRIP_MAX) {
+            trip = &trips[trip_count];
+            if (sscanf(line + 5, "%d %d %d", &trip->temp, &trip->clear,
+                        &trip->max_freq) == 3 && trip->clear <= trip->temp &&
+                    trip->max_freq > 0) {
+                trip_count++;
+                continue;
+            }
+        }
+
+        ALOGE("Ignoring thermal config line: %s", line);
+    }
+
+    fclose(f);
+
+    qsort(trips, trip_count, sizeof(trips[0]), compare_trips);
+    return trip_count > 0;
+}
+
+static bool zone_wanted(const char *type)
+{
+    int i;
+
+    if (!zone_type_count)
+        return true;
+
+    for (i = 0; i < zone_type_count; i++) {
+        if (!strcmp(zone_types[i], type))
+            return true;
+    }
+
+    return false;
+}
+
+static void open_zones(void)
+{
+    char path[PATH_MAX];
+    char real_path[PATH_MAX];
+    char type[THERMAL_TYPE_LEN];
+    struct dirent *de;
+    DIR *dir;
+    int fd;
+
+    dir = opendir(sysfs_path(THERMAL_CLASS_PATH, real_path, sizeof(real_path)));
+    if (!dir) {
+        ALOGE("Error opening %s: %s\n", THERMAL_CLASS_PATH, strerror(errno));
+        return;
+    }
+
+    while ((de = readdir(dir)) && zone_count < THERMAL_ZONE_MAX) {
+        if (strncmp(de->d_name, "thermal_zone", 12))
+            continue;
+
+        snprintf(path, sizeof(path), THERMAL_CLASS_PATH "/%s/type", de->d_name);
+        if (sysfs_read(path, type, sizeof(type)) || !zone_wanted(type))
+            continue;
+
+        snprintf(path, sizeof(path), THERMAL_CLASS_PATH "/%s/temp", de->d_name);
+        fd = open(sysfs_path(path, real_path, sizeof(real_path)), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        zones[zone_count].fd = fd;
+        strcpy(zones[zone_count].type, type);
+        zone_count++;
+        ALOGI("Watching thermal zone %s (%s)\n", de->d_name, type);
+    }
+
+    closedir(dir);
+}
+
+/* Hottest reading across the watched zones, in millidegrees C. */
+static int read_max_temp(void)
+{
+    char buf[16];
+    int max = INT32_MIN;
+    ssize_t len;
+    int i, temp;
+
+    for (i = 0; i < zone_count; i++) {
+        len = pread(zones[i].fd, buf, sizeof(buf) - 1, 0);
+        if (len <= 0)
+            continue;
+        buf[len] = '\0';
+        temp = atoi(buf);
+        if (temp > max)
+            max = temp;
+    }
+
+    return max;
+}
+
+/* Move at most one trip per sample so the cap changes smoothly. */
+static void update_level(int temp)
+{
+    int new_level = level;
+    int cap;
+
+    if (level < trip_count && temp >= trips[level].temp)
+        new_level = level + 1;
+    else if (level > 0 && temp < trips[level - 1].clear)
+        new_level = level - 1;
+
+    if (new_level == level)
+        return;
+
+    level = new_level;
+    cap = level ? trips[level - 1].max_freq : 0;
+    ALOGI("Thermal: %d mC, cap %d kHz\n", temp, cap);
+
+    atomic_store(&current_cap, cap);
+    cap_changed_cb(cap_changed_arg);
+}
+
+static void *thermal_loop(void *arg)
+{
+    struct epoll_event ev;
+    uint64_t expirations;
+    int epfd = (int) (intptr_t) arg;
+    int timer_fd;
+    int temp;
+
+    for (;;) {
+        if (epoll_wait(epfd, &ev, 1, -1) <= 0)
+            continue;
+
+        timer_fd = ev.data.fd;
+        if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            continue;
+
+        temp = read_max_temp();
+        if (temp != INT32_MIN)
+            update_level(temp);
+    }
+
+    return NULL;
+}
+
+/* Sample every THERMAL_POLL_MS starting after first_ns, or stop sampling. */
+static int thermal_timer_arm(bool on, long first_ns)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    if (on) {
+        its.it_value.tv_sec = first_ns / 1000000000L;
+        its.it_value.tv_nsec = first_ns % 1000000000L;
+        its.it_interval.tv_sec = THERMAL_POLL_MS / 1000;
+        its.it_interval.tv_nsec = (THERMAL_POLL_MS % 1000) * 1000000;
+    }
+
+    return timerfd_settime(thermal_timer_fd, 0, &its, NULL);
+}
+
+void thermal_init(void (*cap_changed)(void *arg), void *arg)
+{
+    struct epoll_event ev;
+    int timer_fd, epfd;
+
+    if (cap_changed_cb)
+        return;
+
+    cap_changed_cb = cap_changed;
+    cap_changed_arg = arg;
+
+    if (!load_config())
+        return;
+
+    open_zones();
+    if (!zone_count) {
+        ALOGE("No thermal zones to watch, thermal capping disabled\n");
+        return;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (timer_fd < 0 || epfd < 0) {
+        ALOGE("Error creating thermal timer: %s\n", strerror(errno));
+        goto err;
+    }
+
+    pthread_mutex_lock(&thermal_timer_lock);
+    thermal_timer_fd = timer_fd;
+    if (thermal_timer_arm(true, THERMAL_POLL_MS * 1000000L)) {
+        ALOGE("Error arming thermal timer: %s\n", strerror(errno));
+        thermal_timer_fd = -1;
+        pthread_mutex_unlock(&thermal_timer_lock);
+        goto err;
+    }
+    thermal_polling = true;
+    pthread_mutex_unlock(&thermal_timer_lock);
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = timer_fd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, timer_fd, &ev) ||
+            pthread_create(&thermal_thread, NULL, thermal_loop, (void *) (intptr_t) epfd)) {
+        ALOGE("Error starting thermal thread\n");
+        pthread_mutex_lock(&thermal_timer_lock);
+        thermal_timer_fd = -1;
+        thermal_polling = false;
+        pthread_mutex_unlock(&thermal_timer_lock);
+        goto err;
+    }
+
+    return;
+
+err:
+    if (timer_fd >= 0)
+        close(timer_fd);
+    if (epfd >= 0)
+        close(epfd);
+}
+
+void thermal_set_screen(bool on)
+{
+    pthread_mutex_lock(&thermal_timer_lock);
+
+    /* Back on, take a sample right away in case it warmed up meanwhile. */
+    if (thermal_timer_fd >= 0 && on != thermal_polling) {
+        if (thermal_timer_arm(on, 1))
+            ALOGE("Error %s thermal timer: %s\n", on ? "arming" : "disarming",
+                    strerror(errno));
+        else
+            thermal_polling = on;
+    }
+
+    pthread_mutex_unlock(&thermal_timer_lock);
+}
+
+int thermal_cap(void)
+{
+    return atomic_load(&current_cap);
+}
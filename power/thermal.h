@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_POWER_THERMAL_H
+#define MACALLAN_POWER_THERMAL_H
+
+#include <stdbool.h>
+
+/*
+ * HAL-side thermal capping. A single thread samples the thermal zones on
+ * a timer and steps the frequency cap down and back up one trip point at a
+ * time, so we back off smoothly before the kernel throttles abruptly.
+ * cap_changed is called from that thread whenever thermal_cap() changes.
+ */
+void thermal_init(void (*cap_changed)(void *arg), void *arg);
+
+/* Stop sampling while the screen is off and resume when it comes on. */
+void thermal_set_screen(bool on);
+
+/* Current thermal frequency cap in kHz, 0 when not capping. */
+int thermal_cap(void);
+
+#endif // MACALLAN_POWER_THERMAL_H
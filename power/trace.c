@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LOG_TAG "Macallan PowerHAL"
+#include <utils/Log.h>
+#include <cutils/properties.h>
+
+#include "trace.h"
+#include "util.h"
+
+#define TRACE_MAX_ENTRIES (1 << 20)
+
+/*
+ * seq is the 1-based index of the call stored in the slot, published
+ * last, so the dumper can skip slots that are being overwritten.
+ */
+struct trace_slot {
+    struct trace_entry entry;
+    atomic_uint seq;
+};
+
+static struct trace_slot *trace_ring;
+static unsigned int trace_mask;
+static atomic_uint trace_head;
+
+void trace_init(void)
+{
+    char value[PROPERTY_VALUE_MAX];
+    unsigned long entries;
+    unsigned int size = 1;
+
+    if (trace_ring)
+        return;
+
+    property_get(TRACE_PROPERTY, value, "0");
+    entries = strtoul(value, NULL, 0);
+    if (!entries)
+        return;
+    if (entries > TRACE_MAX_ENTRIES)
+        entries = TRACE_MAX_ENTRIES;
+
+    /* Round up to a power of two so the index wraps with a mask. */
+    while (size < entries)
+        size <<= 1;
+
+    trace_ring = calloc(size, sizeof(*trace_ring));
+    if (!trace_ring) {
+        ALOGE("Error allocating %u trace entries\n", size);
+        return;
+    }
+
+    trace_mask = size - 1;
+    ALOGI("Recording power hints, %u entries\n", size);
+}
+
+void trace_record(uint32_t call, int32_t value)
+{
+    struct trace_slot *slot;
+    unsigned int seq;
+
+    if (!trace_ring)
+        return;
+
+    seq = atomic_fetch_add_explicit(&trace_head, 1, memory_order_relaxed) + 1;
+    slot = &trace_ring[(seq - 1) & trace_mask];
+
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->entry.time_ns = now_ns();
+    slot->entry.call = call;
+    slot->entry.value = value;
+    atomic_store_explicit(&slot->seq, seq, memory_order_release);
+}
+
+void trace_dump(const char *path)
+{
+    struct trace_header header;
+    struct trace_entry entry;
+    char tmp_path[PATH_MAX];
+    unsigned int head, first, seq;
+    long count_pos;
+    FILE *f;
+
+    if (!trace_ring)
+        return;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    f = fopen(tmp_path, "w");
+    if (!f) {
+        ALOGV("Error opening %s: %s\n", tmp_path, strerror(errno));
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    count_pos = ftell(f);
+    fwrite(&header, sizeof(header), 1, f);
+
+    head = atomic_load_explicit(&trace_head, memory_order_acquire);
+    first = head > trace_mask + 1 ? head - trace_mask - 1 : 0;
+
+    for (seq = first + 1; seq != head + 1; seq++) {
+        struct trace_slot *slot = &trace_ring[(seq - 1) & trace_mask];
+
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != seq)
+            continue;
+        entry = slot->entry;
+        atomic_thread_fence(memory_order_acquire);
+        /* Overwritten while we were copying it. */
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq)
+            continue;
+
+        fwrite(&entry, sizeof(entry), 1, f);
+        header.count++;
+    }
+
+    fseek(f, count_pos, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, f);
+
+    if (fclose(f) || rename(tmp_path, path))
+        ALOGE("Error writing %s: %s\n", path, strerror(errno));
+}
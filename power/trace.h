@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_POWER_TRACE_H
+#define MACALLAN_POWER_TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Optional recorder of every setInteractive and powerHint call, for
+ * replaying real sessions against different tunables offline. Enabled by
+ * setting debug.power.trace to the number of calls to keep before the
+ * HAL is initialised. Recording is lock-free and costs a few stores. The
+ * ring is written out with the stats when debug.power.dump is set.
+ */
+#define TRACE_PROPERTY "debug.power.trace"
+#define TRACE_DUMP_PATH "/data/misc/power/trace.bin"
+
+/*
+ * On-disk format, little endian: a trace_header followed by count
+ * trace_entry records, oldest first. Also read by tools/halbench.
+ */
+#define TRACE_MAGIC 0x5254504d /* "MPTR" */
+#define TRACE_VERSION 1
+
+/* Stored in trace_entry.call; hints use their power_hint_t value. */
+#define TRACE_SET_INTERACTIVE 0
+
+struct trace_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct trace_entry {
+    int64_t time_ns;    /* CLOCK_MONOTONIC */
+    uint32_t call;
+    int32_t value;      /* setInteractive on, hint data as an int or !!data */
+};
+
+void trace_init(void);
+void trace_record(uint32_t call, int32_t value);
+
+/* Write the ring out to path, oldest entry first. No-op when disabled. */
+void trace_dump(const char *path);
+
+#endif // MACALLAN_POWER_TRACE_H
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define LOG_TAG "Macallan PowerHAL"
+#include <utils/Log.h>
+
+#include "boost.h"
+#include "sysfs.h"
+#include "tunables.h"
+
+#define TUNABLES_OVERRIDE_PATH "/data/misc/power/tunables.conf"
+#define TUNABLES_SYSTEM_PATH "/system/etc/power_tunables.conf"
+/* Config to use instead of the above, for replaying with other tunables. */
+#define TUNABLES_ENV "MACALLAN_TUNABLES"
+#define INTERACTIVE_PATH "/sys/devices/system/cpu/cpufreq/interactive/"
+#define TUNABLE_VALUE_LEN 64
+
+/*
+ * Knobs that may be set from the config file, with the values used when
+ * no file is found. io_is_busy is left out on purpose: it follows the
+ * screen state in setInteractive.
+ */
+struct tunable {
+    const char *knob;
+    const char *def;
+    char value[TUNABLE_VALUE_LEN];
+};
+
+static struct tunable tunables[] = {
+    { "timer_rate", "20000", "" },
+    { "timer_slack", "80000", "" },
+    { "min_sample_time", "90000", "" },
+    { "hispeed_freq", "1224000", "" },
+    { "go_hispeed_load", "99", "" },
+    { "target_loads", "75 228000:85 696000:90 1530000:95", "" },
+    { "above_hispeed_delay", "20000 1530000:50000", "" },
+    { "boostpulse_duration", "30000", "" },
+};
+
+#define TUNABLES_COUNT (sizeof(tunables) / sizeof(tunables[0]))
+
+static pthread_mutex_t tunables_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Identity of the file last loaded, to detect changes cheaply. */
+static const char *loaded_path;
+static struct timespec loaded_mtime;
+static off_t loaded_size;
+
+static struct tunable *find_tunable(const char *knob)
+{
+    size_t i;
+
+    for (i = 0; i < TUNABLES_COUNT; i++) {
+        if (!strcmp(tunables[i].knob, knob))
+            return &tunables[i];
+    }
+
+    return NULL;
+}
+
+/* Governor values are numbers, optionally "freq:value" pairs. */
+static bool valid_value(const char *value)
+{
+    if (!value[0])
+        return false;
+
+    return strspn(value, "0123456789 :") == strlen(value);
+}
+
+static void parse_line(char *line, const char *path, int lineno)
+{
+    struct tunable *t;
+    char *knob, *value;
+
+    knob = line + strspn(line, " \t");
+    if (*knob == '#' || *knob == '\0')
+        return;
+
+    value = knob + strcspn(knob, " \t");
+    if (*value)
+        *value++ = '\0';
+    value += strspn(value, " \t");
+
+    t = find_tunable(knob);
+    if (!t) {
+        ALOGE("%s:%d: unknown tunable %s\n", path, lineno, knob);
+        return;
+    }
+
+    if (!valid_value(value) || strlen(value) >= TUNABLE_VALUE_LEN) {
+        ALOGE("%s:%d: invalid value for %s: %s\n", path, lineno, knob, value);
+        return;
+    }
+
+    strcpy(t->value, value);
+}
+
+/* Must be called with tunables_lock held. */
+static void load(const char *path, const struct stat *st)
+{
+    char line[256];
+    int lineno = 0;
+    size_t i;
+    FILE *f;
+
+    for (i = 0; i < TUNABLES_COUNT; i++)
+        strcpy(tunables[i].value, tunables[i].def);
+
+    loaded_path = path;
+    if (!path) {
+        ALOGI("No governor tunables file, using defaults\n");
+        return;
+    }
+
+    loaded_mtime = st->st_mtim;
+    loaded_size = st->st_size;
+
+    f = fopen(path, "r");
+    if (!f) {
+        ALOGE("Error opening %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        line[strcspn(line, "\r\n")] = '\0';
+        parse_line(line, path, lineno);
+    }
+
+    fclose(f);
+    ALOGI("Loaded governor tunables from %s\n", path);
+}
+
+/* Must be called with tunables_lock held. */
+static void apply(void)
+{
+    char path[128];
+    size_t i;
+
+    for (i = 0; i < TUNABLES_COUNT; i++) {
+        /* The boost code owns hispeed_freq while a boost is held. */
+        if (!strcmp(tunables[i].knob, "hispeed_freq")) {
+            boost_set_default_hispeed(tunables[i].value);
+            continue;
+        }
+
+        snprintf(path, sizeof(path), INTERACTIVE_PATH "%s", tunables[i].knob);
+        sysfs_write(path, tunables[i].value);
+    }
+}
+
+static const char *find_config(struct stat *st)
+{
+    const char *env = getenv(TUNABLES_ENV);
+
+    if (env && !stat(env, st))
+        return env;
+    if (!stat(TUNABLES_OVERRIDE_PATH, st))
+        return TUNABLES_OVERRIDE_PATH;
+    if (!stat(TUNABLES_SYSTEM_PATH, st))
+        return TUNABLES_SYSTEM_PATH;
+    return NULL;
+}
+
+void tunables_init(void)
+{
+    struct stat st;
+    const char *path = find_config(&st);
+
+    pthread_mutex_lock(&tunables_lock);
+    load(path, &st);
+    apply();
+    pthread_mutex_unlock(&tunables_lock);
+}
+
+bool tunables_reload_if_changed(void)
+{
+    struct stat st;
+    const char *path = find_config(&st);
+
+    pthread_mutex_lock(&tunables_lock);
+
+    if (path == loaded_path && (!path || (st.st_size == loaded_size &&
+            st.st_mtim.tv_sec == loaded_mtime.tv_sec &&
+            st.st_mtim.tv_nsec == loaded_mtime.tv_nsec))) {
+        pthread_mutex_unlock(&tunables_lock);
+        return false;
+    }
+
+    load(path, &st);
+    apply();
+    pthread_mutex_unlock(&tunables_lock);
+
+    return true;
+}
+
+int tunables_get_int(const char *knob, int def)
+{
+    struct tunable *t;
+    int value = def;
+
+    pthread_mutex_lock(&tunables_lock);
+    t = find_tunable(knob);
+    if (t && t->value[0])
+        value = atoi(t->value);
+    pthread_mutex_unlock(&tunables_lock);
+
+    return value;
+}
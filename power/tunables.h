@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_POWER_TUNABLES_H
+#define MACALLAN_POWER_TUNABLES_H
+
+#include <stdbool.h>
+
+/*
+ * Interactive governor tunables, read from a small config file instead of
+ * being hardcoded. /data/misc/power/tunables.conf takes precedence over
+ * the copy in /system/etc so settings can be tried out without a rebuild.
+ */
+void tunables_init(void);
+
+/*
+ * Reload and reapply the tunables if the config file changed since the
+ * last load. Returns true if anything was reloaded.
+ */
+bool tunables_reload_if_changed(void);
+
+/* Current value of a numeric tunable, or def if it is not set. */
+int tunables_get_int(const char *knob, int def);
+
+#endif // MACALLAN_POWER_TUNABLES_H
@@ -3,12 +3,16 @@ LOCAL_PATH := $(call my-dir)
 include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES := \
+    Fusion.cpp \
+    LightFilter.cpp \
+    SensorFifo.cpp \
+    SensorRing.cpp \
     SensorWrapper.cpp
 
 LOCAL_C_INCLUDES += $(LOCAL_PATH)
 
 LOCAL_SHARED_LIBRARIES := \
-    libhardware liblog
+    libcutils libhardware liblog
 
 
 LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)/hw
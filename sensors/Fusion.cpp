@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <string.h>
+
+#include "Fusion.h"
+
+/* Madgwick's suggested gain for MEMS gyros of a few degrees/s error. */
+#define DEFAULT_BETA 0.1f
+#define GRAVITY_EARTH 9.80665f
+
+typedef float vec4 __attribute__((vector_size(16)));
+
+#define SHUFFLE(v, a, b, c, d) __builtin_shufflevector(v, v, a, b, c, d)
+
+static inline vec4 splat(float s)
+{
+    vec4 v = { s, s, s, s };
+    return v;
+}
+
+static inline float dot(vec4 a, vec4 b)
+{
+    vec4 p = a * b;
+    return p[0] + p[1] + p[2] + p[3];
+}
+
+/* Scale in to unit length into out, returning false if it is zero. */
+static bool normalize3(const float in[3], float out[3])
+{
+    float norm = sqrtf(in[0] * in[0] + in[1] * in[1] + in[2] * in[2]);
+
+    if (norm == 0.0f)
+        return false;
+    for (int i = 0; i < 3; i++)
+        out[i] = in[i] / norm;
+    return true;
+}
+
+static void cross(const float a[3], const float b[3], float out[3])
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+Fusion::Fusion()
+    : mBeta(DEFAULT_BETA), mInitialized(false)
+{
+    mQ[0] = 1.0f;
+    mQ[1] = mQ[2] = mQ[3] = 0.0f;
+}
+
+/*
+ * Start from the attitude accel and mag give directly rather than letting
+ * the filter converge from identity, which takes seconds at a low gain.
+ * Without mag the heading is whatever needs the least rotation.
+ */
+bool Fusion::initialize(const FusionSample &sample)
+{
+    float up[3], mag[3], east[3], north[3];
+    float r[3][3], trace, s;
+
+    if (!normalize3(sample.accel, up))
+        return false;
+
+    cross(sample.mag, up, east);
+    if (!normalize3(sample.mag, mag) || !normalize3(east, east)) {
+        float w = 1.0f + up[2];
+
+        if (w < 1e-6f) {
+            mQ[0] = 0.0f;
+            mQ[1] = 1.0f;
+            mQ[2] = mQ[3] = 0.0f;
+        } else {
+            float norm = sqrtf(w * w + up[1] * up[1] + up[0] * up[0]);
+            mQ[0] = w / norm;
+            mQ[1] = up[1] / norm;
+            mQ[2] = -up[0] / norm;
+            mQ[3] = 0.0f;
+        }
+        mInitialized = true;
+        return true;
+    }
+    cross(up, east, north);
+
+    /* Rows are the north, west and up axes in device coordinates. */
+    for (int i = 0; i < 3; i++) {
+        r[0][i] = north[i];
+        r[1][i] = -east[i];
+        r[2][i] = up[i];
+    }
+
+    trace = r[0][0] + r[1][1] + r[2][2];
+    if (trace > 0.0f) {
+        s = 2.0f * sqrtf(1.0f + trace);
+        mQ[0] = 0.25f * s;
+        mQ[1] = (r[2][1] - r[1][2]) / s;
+        mQ[2] = (r[0][2] - r[2][0]) / s;
+        mQ[3] = (r[1][0] - r[0][1]) / s;
+    } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+        s = 2.0f * sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]);
+        mQ[0] = (r[2][1] - r[1][2]) / s;
+        mQ[1] = 0.25f * s;
+        mQ[2] = (r[0][1] + r[1][0]) / s;
+        mQ[3] = (r[0][2] + r[2][0]) / s;
+    } else if (r[1][1] > r[2][2]) {
+        s = 2.0f * sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]);
+        mQ[0] = (r[0][2] - r[2][0]) / s;
+        mQ[1] = (r[0][1] + r[1][0]) / s;
+        mQ[2] = 0.25f * s;
+        mQ[3] = (r[1][2] + r[2][1]) / s;
+    } else {
+        s = 2.0f * sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]);
+        mQ[0] = (r[1][0] - r[0][1]) / s;
+        mQ[1] = (r[0][2] + r[2][0]) / s;
+        mQ[2] = (r[1][2] + r[2][1]) / s;
+        mQ[3] = 0.25f * s;
+    }
+
+    mInitialized = true;
+    return true;
+}
+
+/*
+ * The gradient of the accel and mag errors is accumulated as a sum of
+ * Jacobian rows, each of which is a lane shuffle of q times constants,
+ * so the whole step stays in vector registers.
+ */
+void Fusion::update(const FusionSample *samples, size_t count, float (*out)[4])
+{
+    const vec4 signs_j1 = { -2.0f, 2.0f, -2.0f, 2.0f };
+    const vec4 signs_j3 = { 0.0f, -4.0f, -4.0f, 0.0f };
+    const vec4 signs_j4 = { 0.0f, 0.0f, -4.0f, -4.0f };
+    const vec4 signs_j5 = { -2.0f, 2.0f, 2.0f, -2.0f };
+    const vec4 signs_x = { -1.0f, 1.0f, -1.0f, 1.0f };
+    const vec4 signs_y = { -1.0f, 1.0f, 1.0f, -1.0f };
+    const vec4 signs_z = { -1.0f, -1.0f, 1.0f, 1.0f };
+    vec4 q = { mQ[0], mQ[1], mQ[2], mQ[3] };
+
+    for (size_t i = 0; i < count; i++) {
+        const FusionSample &sample = samples[i];
+        float a[3], m[3];
+
+        if (!mInitialized) {
+            initialize(sample);
+            q = (vec4) { mQ[0], mQ[1], mQ[2], mQ[3] };
+            if (out)
+                memcpy(out[i], mQ, sizeof(mQ));
+            continue;
+        }
+
+        /* Rate of change from the gyro: q * (0, gyro) / 2. */
+        vec4 g = { 0.0f, sample.gyro[0], sample.gyro[1], sample.gyro[2] };
+        vec4 qdot = splat(q[0]) * g +
+                splat(q[1]) * SHUFFLE(g, 1, 0, 3, 2) * signs_x +
+                splat(q[2]) * SHUFFLE(g, 2, 3, 0, 1) * signs_y +
+                splat(q[3]) * SHUFFLE(g, 3, 2, 1, 0) * signs_z;
+        qdot *= splat(0.5f);
+
+        if (normalize3(sample.accel, a)) {
+            vec4 j1 = SHUFFLE(q, 2, 3, 0, 1) * signs_j1;
+            vec4 j2 = SHUFFLE(q, 1, 0, 3, 2) * splat(2.0f);
+            vec4 j3 = q * signs_j3;
+            vec4 qq = q * q;
+            vec4 row0, row2;
+            float f1, f2, f3, norm;
+
+            f1 = 2.0f * (q[1] * q[3] - q[0] * q[2]) - a[0];
+            f2 = 2.0f * (q[0] * q[1] + q[2] * q[3]) - a[1];
+            f3 = 1.0f - 2.0f * (qq[1] + qq[2]) - a[2];
+            vec4 grad = splat(f1) * j1 + splat(f2) * j2 + splat(f3) * j3;
+
+            if (normalize3(sample.mag, m)) {
+                float r[3][3], hx, hy, hz, bx, bz;
+
+                r[0][0] = 1.0f - 2.0f * (qq[2] + qq[3]);
+                r[0][1] = 2.0f * (q[1] * q[2] - q[0] * q[3]);
+                r[0][2] = 2.0f * (q[1] * q[3] + q[0] * q[2]);
+                r[1][0] = 2.0f * (q[1] * q[2] + q[0] * q[3]);
+                r[1][1] = 1.0f - 2.0f * (qq[1] + qq[3]);
+                r[1][2] = 2.0f * (q[2] * q[3] - q[0] * q[1]);
+                r[2][0] = f1 + a[0];
+                r[2][1] = f2 + a[1];
+                r[2][2] = f3 + a[2];
+
+                /* Earth field flattened onto the north-up plane. */
+                hx = r[0][0] * m[0] + r[0][1] * m[1] + r[0][2] * m[2];
+                hy = r[1][0] * m[0] + r[1][1] * m[1] + r[1][2] * m[2];
+                hz = r[2][0] * m[0] + r[2][1] * m[1] + r[2][2] * m[2];
+                bx = sqrtf(hx * hx + hy * hy);
+                bz = hz;
+
+                row0 = (vec4) { r[0][0], r[0][1], r[0][2], 0.0f };
+                row2 = (vec4) { r[2][0], r[2][1], r[2][2], 0.0f };
+                vec4 f = splat(bx) * row0 + splat(bz) * row2 -
+                        (vec4) { m[0], m[1], m[2], 0.0f };
+
+                vec4 j4 = splat(bz) * j1 + splat(bx) * q * signs_j4;
+                vec4 j5 = splat(bz) * j2 + splat(bx) * SHUFFLE(q, 3, 2, 1, 0) * signs_j5;
+                vec4 j6 = splat(bx) * SHUFFLE(q, 2, 3, 0, 1) * splat(2.0f) + splat(bz) * j3;
+                grad += splat(f[0]) * j4 + splat(f[1]) * j5 + splat(f[2]) * j6;
+            }
+
+            norm = dot(grad, grad);
+            if (norm > 0.0f)
+                qdot -= splat(mBeta / sqrtf(norm)) * grad;
+        }
+
+        q += qdot * splat(sample.dt);
+        q *= splat(1.0f / sqrtf(dot(q, q)));
+
+        if (out) {
+            out[i][0] = q[0];
+            out[i][1] = q[1];
+            out[i][2] = q[2];
+            out[i][3] = q[3];
+        }
+    }
+
+    mQ[0] = q[0];
+    mQ[1] = q[1];
+    mQ[2] = q[2];
+    mQ[3] = q[3];
+}
+
+void Fusion::updateScalar(const FusionSample *samples, size_t count, float (*out)[4])
+{
+    float q0 = mQ[0], q1 = mQ[1], q2 = mQ[2], q3 = mQ[3];
+
+    for (size_t i = 0; i < count; i++) {
+        const FusionSample &sample = samples[i];
+        float gx = sample.gyro[0], gy = sample.gyro[1], gz = sample.gyro[2];
+        float a[3], m[3], norm;
+
+        if (!mInitialized) {
+            initialize(sample);
+            q0 = mQ[0];
+            q1 = mQ[1];
+            q2 = mQ[2];
+            q3 = mQ[3];
+            if (out)
+                memcpy(out[i], mQ, sizeof(mQ));
+            continue;
+        }
+
+        float d0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+        float d1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+        float d2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+        float d3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+        if (normalize3(sample.accel, a)) {
+            float f1 = 2.0f * (q1 * q3 - q0 * q2) - a[0];
+            float f2 = 2.0f * (q0 * q1 + q2 * q3) - a[1];
+            float f3 = 1.0f - 2.0f * (q1 * q1 + q2 * q2) - a[2];
+            float s0 = -2.0f * q2 * f1 + 2.0f * q1 * f2;
+            float s1 = 2.0f * q3 * f1 + 2.0f * q0 * f2 - 4.0f * q1 * f3;
+            float s2 = -2.0f * q0 * f1 + 2.0f * q3 * f2 - 4.0f * q2 * f3;
+            float s3 = 2.0f * q1 * f1 + 2.0f * q2 * f2;
+
+            if (normalize3(sample.mag, m)) {
+                float hx = (1.0f - 2.0f * (q2 * q2 + q3 * q3)) * m[0] +
+                        2.0f * (q1 * q2 - q0 * q3) * m[1] +
+                        2.0f * (q1 * q3 + q0 * q2) * m[2];
+                float hy = 2.0f * (q1 * q2 + q0 * q3) * m[0] +
+                        (1.0f - 2.0f * (q1 * q1 + q3 * q3)) * m[1] +
+                        2.0f * (q2 * q3 - q0 * q1) * m[2];
+                float hz = (f1 + a[0]) * m[0] + (f2 + a[1]) * m[1] + (f3 + a[2]) * m[2];
+                float bx = sqrtf(hx * hx + hy * hy);
+                float bz = hz;
+                float f4 = bx * (1.0f - 2.0f * (q2 * q2 + q3 * q3)) +
+                        bz * 2.0f * (q1 * q3 - q0 * q2) - m[0];
+                float f5 = bx * 2.0f * (q1 * q2 - q0 * q3) +
+                        bz * 2.0f * (q0 * q1 + q2 * q3) - m[1];
+                float f6 = bx * 2.0f * (q1 * q3 + q0 * q2) +
+                        bz * (1.0f - 2.0f * (q1 * q1 + q2 * q2)) - m[2];
+
+                s0 += -2.0f * bz * q2 * f4 + (-2.0f * bx * q3 + 2.0f * bz * q1) * f5 +
+                        2.0f * bx * q2 * f6;
+                s1 += 2.0f * bz * q3 * f4 + (2.0f * bx * q2 + 2.0f * bz * q0) * f5 +
+                        (2.0f * bx * q3 - 4.0f * bz * q1) * f6;
+                s2 += (-4.0f * bx * q2 - 2.0f * bz * q0) * f4 +
+                        (2.0f * bx * q1 + 2.0f * bz * q3) * f5 +
+                        (2.0f * bx * q0 - 4.0f * bz * q2) * f6;
+                s3 += (-4.0f * bx * q3 + 2.0f * bz * q1) * f4 +
+                        (-2.0f * bx * q0 + 2.0f * bz * q2) * f5 +
+                        2.0f * bx * q1 * f6;
+            }
+
+            norm = sqrtf(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+            if (norm > 0.0f) {
+                d0 -= mBeta * s0 / norm;
+                d1 -= mBeta * s1 / norm;
+                d2 -= mBeta * s2 / norm;
+                d3 -= mBeta * s3 / norm;
+            }
+        }
+
+        q0 += d0 * sample.dt;
+        q1 += d1 * sample.dt;
+        q2 += d2 * sample.dt;
+        q3 += d3 * sample.dt;
+        norm = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+        q0 *= norm;
+        q1 *= norm;
+        q2 *= norm;
+        q3 *= norm;
+
+        if (out) {
+            out[i][0] = q0;
+            out[i][1] = q1;
+            out[i][2] = q2;
+            out[i][3] = q3;
+        }
+    }
+
+    mQ[0] = q0;
+    mQ[1] = q1;
+    mQ[2] = q2;
+    mQ[3] = q3;
+}
+
+/* Turn north, west, up into east, north, up: 90 degrees about up. */
+void Fusion::rotationVector(const float q[4], float out[4])
+{
+    const float c = (float) M_SQRT1_2;
+    float w = c * (q[0] - q[3]);
+
+    out[0] = c * (q[1] - q[2]);
+    out[1] = c * (q[2] + q[1]);
+    out[2] = c * (q[3] + q[0]);
+    out[3] = w;
+    /* Android prefers the rotation vector with a non-negative w. */
+    if (w < 0.0f) {
+        for (int i = 0; i < 4; i++)
+            out[i] = -out[i];
+    }
+}
+
+void Fusion::gravity(const float q[4], float out[3])
+{
+    out[0] = GRAVITY_EARTH * 2.0f * (q[1] * q[3] - q[0] * q[2]);
+    out[1] = GRAVITY_EARTH * 2.0f * (q[0] * q[1] + q[2] * q[3]);
+    out[2] = GRAVITY_EARTH * (q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3]);
+}
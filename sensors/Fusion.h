@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef MACALLAN_FUSION_H
+#define MACALLAN_FUSION_H
+
+#include <stddef.h>
+
+/*
+ * One gyro sample with the latest accel and mag readings, in the units
+ * of the Android sensor events: rad/s, m/s^2 and uT. A zero accel or mag
+ * vector means there is no reading to correct against yet.
+ */
+struct FusionSample {
+    float gyro[3];
+    float accel[3];
+    float mag[3];
+    /* Seconds since the previous sample. */
+    float dt;
+};
+
+/*
+ * Madgwick gradient descent orientation filter over accel, gyro and mag.
+ * The quaternion is w, x, y, z and rotates device coordinates into a
+ * north, west, up earth frame. update() works on four wide vector types,
+ * which become NEON on armv7-a-neon; updateScalar() is the plain float
+ * reference it is checked and benchmarked against. Not locked.
+ */
+class Fusion {
+public:
+    Fusion();
+
+    /* How hard accel and mag pull against gyro drift, in rad/s. */
+    void setGain(float beta) { mBeta = beta; }
+    /* Start over from the next sample's accel and mag. */
+    void reset() { mInitialized = false; }
+    bool initialized() const { return mInitialized; }
+
+    /* Run count samples, storing the orientation after each in out if set. */
+    void update(const FusionSample *samples, size_t count, float (*out)[4]);
+    void updateScalar(const FusionSample *samples, size_t count, float (*out)[4]);
+
+    const float *quaternion() const { return mQ; }
+
+    /* Android rotation vector x, y, z, w in the east, north, up frame. */
+    static void rotationVector(const float q[4], float out[4]);
+    /* Gravity in device coordinates, m/s^2. */
+    static void gravity(const float q[4], float out[3]);
+
+private:
+    bool initialize(const FusionSample &sample);
+
+    float mBeta;
+    bool mInitialized;
+    float mQ[4];
+};
+
+#endif // MACALLAN_FUSION_H
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+
+#include "LightFilter.h"
+
+LightFilter::LightFilter()
+    : mRelative(0), mAbsolute(0), mMinIntervalNs(0),
+      mReported(false), mLastLux(0), mLastNs(0), mHeld(false),
+      mSuppressed(0), mSeen(0)
+{
+}
+
+void LightFilter::configure(float relative, float absolute, int64_t minIntervalNs)
+{
+    mRelative = relative > 0 ? relative : 0;
+    mAbsolute = absolute > 0 ? absolute : 0;
+    mMinIntervalNs = minIntervalNs > 0 ? minIntervalNs : 0;
+}
+
+void LightFilter::reset()
+{
+    mReported = false;
+    mHeld = false;
+    mSuppressed = 0;
+    mSeen = 0;
+}
+
+bool LightFilter::accept(const sensors_event_t &event)
+{
+    float lux = event.light;
+    float band;
+
+    mSeen++;
+
+    if (mReported) {
+        band = fmaxf(mAbsolute, mRelative * mLastLux);
+        /* Back inside the band; whatever was held did not last. */
+        if (fabsf(lux - mLastLux) <= band) {
+            mHeld = false;
+            mSuppressed++;
+            return false;
+        }
+        if (event.timestamp - mLastNs < mMinIntervalNs) {
+            mHeld = true;
+            mHeldEvent = event;
+            mSuppressed++;
+            return false;
+        }
+    }
+
+    mHeld = false;
+    mReported = true;
+    mLastLux = lux;
+    mLastNs = event.timestamp;
+    return true;
+}
+
+int64_t LightFilter::deadline() const
+{
+    return mHeld ? mLastNs + mMinIntervalNs : 0;
+}
+
+bool LightFilter::release(int64_t now, bool force, sensors_event_t *out)
+{
+    if (!mHeld || (!force && now < deadline()))
+        return false;
+
+    *out = mHeldEvent;
+    mHeld = false;
+    mSuppressed--;
+    mLastLux = out->light;
+    /* The interval runs from when the reading was passed on. */
+    mLastNs = now;
+    return true;
+}
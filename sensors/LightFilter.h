@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef MACALLAN_LIGHT_FILTER_H
+#define MACALLAN_LIGHT_FILTER_H
+
+#include <stdint.h>
+
+#include <hardware/sensors.h>
+
+/*
+ * Hysteresis for the light sensor, which reports lux jitter continuously
+ * although it is declared on-change. A reading is passed on only once it
+ * leaves the band around the last reported one, which is the larger of
+ * a fraction of that reading and a fixed number of lux, and no sooner
+ * than the minimum interval after it. A reading that leaves the band
+ * too soon is held rather than dropped, replaced by any later one, and
+ * released once the interval is up, so a step that settles right away
+ * is still reported. The first reading after reset() always goes
+ * through. Not locked.
+ */
+class LightFilter {
+public:
+    LightFilter();
+
+    void configure(float relative, float absolute, int64_t minIntervalNs);
+    void reset();
+
+    /* Whether event should be reported; counts it as suppressed if not. */
+    bool accept(const sensors_event_t &event);
+
+    /* When the held reading is due, 0 if none is held. */
+    int64_t deadline() const;
+
+    /*
+     * Move the held reading to out if it is due at now, or whenever one
+     * is held with force. Returns whether it did.
+     */
+    bool release(int64_t now, bool force, sensors_event_t *out);
+
+    uint64_t suppressed() const { return mSuppressed; }
+    uint64_t seen() const { return mSeen; }
+
+private:
+    float mRelative;
+    float mAbsolute;
+    int64_t mMinIntervalNs;
+
+    bool mReported;
+    float mLastLux;
+    int64_t mLastNs;
+    bool mHeld;
+    sensors_event_t mHeldEvent;
+    uint64_t mSuppressed;
+    uint64_t mSeen;
+};
+
+#endif // MACALLAN_LIGHT_FILTER_H
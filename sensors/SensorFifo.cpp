@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <new>
+#include <string.h>
+
+#include "SensorFifo.h"
+
+SensorFifo::SensorFifo()
+    : mEvents(NULL), mCapacity(0), mHead(0), mSize(0), mDropped(0)
+{
+}
+
+SensorFifo::~SensorFifo()
+{
+    delete[] mEvents;
+}
+
+bool SensorFifo::init(size_t capacity)
+{
+    delete[] mEvents;
+    mEvents = NULL;
+    mCapacity = 0;
+    clear();
+
+    if (!capacity)
+        return true;
+
+    mEvents = new (std::nothrow) sensors_event_t[capacity];
+    if (!mEvents)
+        return false;
+
+    mCapacity = capacity;
+    return true;
+}
+
+void SensorFifo::push(const sensors_event_t &event)
+{
+    if (!mCapacity)
+        return;
+
+    if (full()) {
+        mHead = (mHead + 1) % mCapacity;
+        mSize--;
+        mDropped++;
+    }
+
+    mEvents[(mHead + mSize) % mCapacity] = event;
+    mSize++;
+}
+
+size_t SensorFifo::pop(sensors_event_t *out, size_t count)
+{
+    size_t n = count < mSize ? count : mSize;
+    size_t first = mCapacity - mHead < n ? mCapacity - mHead : n;
+
+    if (!n)
+        return 0;
+
+    memcpy(out, mEvents + mHead, first * sizeof(*out));
+    memcpy(out + first, mEvents, (n - first) * sizeof(*out));
+
+    mHead = mCapacity ? (mHead + n) % mCapacity : 0;
+    mSize -= n;
+    return n;
+}
+
+void SensorFifo::clear()
+{
+    mHead = 0;
+    mSize = 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_SENSOR_FIFO_H
+#define MACALLAN_SENSOR_FIFO_H
+
+#include <stddef.h>
+
+#include <hardware/sensors.h>
+
+/*
+ * Fixed size event FIFO standing in for the hardware FIFO the vendor
+ * sensors do not have. When full the oldest event is dropped, as a
+ * non-wake-up hardware FIFO would. Not locked.
+ */
+class SensorFifo {
+public:
+    SensorFifo();
+    ~SensorFifo();
+
+    bool init(size_t capacity);
+
+    size_t capacity() const { return mCapacity; }
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+    bool full() const { return mSize == mCapacity; }
+    unsigned int dropped() const { return mDropped; }
+
+    void push(const sensors_event_t &event);
+    /* Move up to count events to out, oldest first. */
+    size_t pop(sensors_event_t *out, size_t count);
+    void clear();
+
+private:
+    SensorFifo(const SensorFifo &);
+    SensorFifo &operator=(const SensorFifo &);
+
+    sensors_event_t *mEvents;
+    size_t mCapacity;
+    size_t mHead;
+    size_t mSize;
+    unsigned int mDropped;
+};
+
+#endif // MACALLAN_SENSOR_FIFO_H
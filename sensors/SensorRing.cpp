@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <new>
+#include <string.h>
+
+#include "SensorRing.h"
+
+SensorRing::SensorRing()
+    : mEvents(NULL), mMask(0), mHead(0), mTail(0), mDropped(0), mOverflows(0),
+      mOverflowing(false)
+{
+}
+
+SensorRing::~SensorRing()
+{
+    delete[] mEvents;
+}
+
+bool SensorRing::init(size_t capacity)
+{
+    size_t size = 1;
+
+    while (size < capacity)
+        size <<= 1;
+
+    delete[] mEvents;
+    mEvents = new (std::nothrow) sensors_event_t[size];
+    if (!mEvents)
+        return false;
+
+    mMask = size - 1;
+    mHead.store(0, std::memory_order_relaxed);
+    mTail.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+size_t SensorRing::push(const sensors_event_t *events, size_t count)
+{
+    uint32_t tail = mTail.load(std::memory_order_relaxed);
+    uint32_t head = mHead.load(std::memory_order_acquire);
+    size_t room = capacity() - (tail - head);
+    size_t n = count < room ? count : room;
+
+    for (size_t i = 0; i < n; i++)
+        mEvents[(tail + i) & mMask] = events[i];
+    mTail.store(tail + n, std::memory_order_release);
+
+    if (n < count) {
+        mDropped.fetch_add(count - n, std::memory_order_relaxed);
+        if (!mOverflowing)
+            mOverflows.fetch_add(1, std::memory_order_relaxed);
+        mOverflowing = true;
+    } else {
+        mOverflowing = false;
+    }
+
+    return n;
+}
+
+size_t SensorRing::pop(sensors_event_t *out, size_t count)
+{
+    uint32_t head = mHead.load(std::memory_order_relaxed);
+    uint32_t tail = mTail.load(std::memory_order_acquire);
+    size_t avail = tail - head;
+    size_t n = count < avail ? count : avail;
+    size_t slot = head & mMask;
+    size_t first = capacity() - slot < n ? capacity() - slot : n;
+
+    if (!n)
+        return 0;
+
+    memcpy(out, mEvents + slot, first * sizeof(*out));
+    memcpy(out + first, mEvents, (n - first) * sizeof(*out));
+    mHead.store(head + n, std::memory_order_release);
+
+    return n;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_SENSOR_RING_H
+#define MACALLAN_SENSOR_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <hardware/sensors.h>
+
+/*
+ * Single producer, single consumer event ring between the vendor reader
+ * thread and poll(). Neither side takes a lock. When the ring is full
+ * new events are dropped and counted; the producer cannot overwrite
+ * what the consumer may be copying.
+ */
+class SensorRing {
+public:
+    SensorRing();
+    ~SensorRing();
+
+    /* Capacity is rounded up to a power of two. */
+    bool init(size_t capacity);
+    size_t capacity() const { return mMask + 1; }
+
+    /* Producer side. Returns how many of the events fitted. */
+    size_t push(const sensors_event_t *events, size_t count);
+
+    /* Consumer side. Moves up to count events out, oldest first. */
+    size_t pop(sensors_event_t *out, size_t count);
+
+    /*
+     * Free running counts of events pushed and popped so far, for telling
+     * whether everything pushed before some point has been consumed.
+     */
+    uint32_t pushed() const { return mTail.load(std::memory_order_acquire); }
+    uint32_t popped() const { return mHead.load(std::memory_order_relaxed); }
+
+    /* Events dropped because the ring was full, and how often that began. */
+    uint64_t dropped() const { return mDropped.load(std::memory_order_relaxed); }
+    uint32_t overflows() const { return mOverflows.load(std::memory_order_relaxed); }
+
+private:
+    SensorRing(const SensorRing &);
+    SensorRing &operator=(const SensorRing &);
+
+    sensors_event_t *mEvents;
+    uint32_t mMask;
+    /* Free running; the slot is the index masked. */
+    std::atomic<uint32_t> mHead;
+    std::atomic<uint32_t> mTail;
+    std::atomic<uint64_t> mDropped;
+    std::atomic<uint32_t> mOverflows;
+    /* Producer only: the previous push did not fit. */
+    bool mOverflowing;
+};
+
+#endif // MACALLAN_SENSOR_RING_H
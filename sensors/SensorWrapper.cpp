@@ -27,18 +27,132 @@
 #define LOG_TAG "SensorWrapper"
 #include <cutils/log.h>
 
+#include <errno.h>
+#include <new>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <cutils/properties.h>
+
 #include <utils/threads.h>
 #include <hardware/hardware.h>
 #include <hardware/sensors.h>
 
+#include "Fusion.h"
+#include "LightFilter.h"
+#include "SensorFifo.h"
+#include "SensorRing.h"
 #include "SensorWrapper.h"
 
+/*
+ * Events between the vendor reader thread and poll(). The size can be
+ * raised for debugging bursty clients without a rebuild.
+ */
+#define RING_SIZE_PROP "ro.sensors.wrapper.ring_size"
+#define DEFAULT_RING_SIZE 1024
+/* Events read from the vendor device at a time. */
+#define VENDOR_READ_EVENTS 64
+
+/*
+ * The MPL runs all its sensors off one sampling clock, so every MPL
+ * sensor is run at the fastest period asked of any of them and each
+ * stream is brought back down to its own period here. Raw accel, gyro
+ * and mag samples in between are averaged rather than dropped. Events
+ * closer together than 7/8 of the period count as early.
+ */
+#define PERIOD_SLACK_DIV 8
+
+/*
+ * Light sensor hysteresis, so auto-brightness is not woken by jitter:
+ * the change in percent of the last reported lux and the change in lux
+ * that must both be exceeded, and the shortest time between reports.
+ */
+#define LIGHT_RELATIVE_PROP "ro.sensors.light.hysteresis_pct"
+#define LIGHT_ABSOLUTE_PROP "ro.sensors.light.hysteresis_lux"
+#define LIGHT_INTERVAL_PROP "ro.sensors.light.min_interval_ms"
+#define DEFAULT_LIGHT_RELATIVE_PCT 10
+#define DEFAULT_LIGHT_ABSOLUTE_LUX 2
+#define DEFAULT_LIGHT_INTERVAL_MS 250
+
+/*
+ * With this set, rotation vector, gravity and linear accel are fused
+ * here from the raw sensors instead of inside the MPL, so they run at
+ * the rate asked for and batch like the raw sensors do. Gyro samples
+ * are fused a read's worth at a time; a gap longer than the slowest
+ * rate restarts the filter instead of integrating across it.
+ */
+#define FUSION_PROP "ro.sensors.wrapper.fusion"
+#define FUSION_BATCH VENDOR_READ_EVENTS
+#define FUSION_MAX_GAP_NS (MPL_MAX_DELAY * 1000LL)
+
+/*
+ * Batching is emulated on top of the vendor device, which only knows
+ * setDelay. Events of a sensor with a report latency are held in its
+ * SensorFifo and handed to the framework together once the oldest has
+ * waited for the latency, the FIFO fills up or a flush is requested.
+ */
+typedef struct {
+    SensorFifo fifo;
+    bool active;
+    /* Sampling period asked for by the framework, 0 if never set. */
+    int64_t period_ns;
+    /* Period last passed to the vendor device, and whether it is on there. */
+    int64_t vendor_period_ns;
+    bool vendor_active;
+    /* Timestamp of the last event passed on, and the samples since. */
+    int64_t last_ns;
+    float sum[3];
+    int samples;
+    int64_t latency_ns;
+    /* When the oldest buffered event is due, 0 if nothing is buffered. */
+    int64_t deadline_ns;
+    /* Flush complete events still to be delivered. */
+    int flushes;
+    /*
+     * ring.pushed() at the latest flush. The flush completes only once
+     * poll() has consumed the ring up to there, so events read before the
+     * flush are not reported after it.
+     */
+    uint32_t flush_pos;
+} sensor_state_t;
+
 typedef struct {
-    sensors_poll_device_t base;
+    sensors_poll_device_1_t base;
     union {
         sensors_poll_device_t *device;
         hw_device_t *hw_device;
     } vendor;
+    /* Guards sensors, light_filter and the fusion state. */
+    android::Mutex lock;
+    sensor_state_t sensors[ID_MAX];
+    LightFilter light_filter;
+    /*
+     * Software fusion, see FUSION_PROP. fusing is set while a fused
+     * sensor is active, which keeps the raw sensors it needs running.
+     */
+    bool fusion;
+    bool fusing;
+    Fusion fusion_filter;
+    float accel[3];
+    float mag[3];
+    int64_t gyro_ns;
+    /*
+     * The vendor poll() blocks for as long as it likes, so it is called
+     * from a thread of our own that feeds ring. poll() sleeps on wake_fd,
+     * which the reader and flush() signal.
+     */
+    SensorRing ring;
+    int wake_fd;
+    pthread_t reader;
+    bool reader_running;
+    std::atomic<bool> stop;
+    /* Ring overflows already logged. */
+    uint32_t overflows_logged;
 } device_t;
 
 static android::Mutex vendor_mutex;
@@ -77,33 +191,600 @@ static bool ensure_vendor_module_is_loaded(void)
     return vendor.module != NULL;
 }
 
+static const struct sensor_t *find_sensor(int handle)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(sSensorList); i++) {
+        if (sSensorList[i].handle == handle)
+            return &sSensorList[i];
+    }
+
+    return NULL;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    /* Same clock as event timestamps. */
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void wake_poll(device_t *device)
+{
+    uint64_t one = 1;
+
+    if (write(device->wake_fd, &one, sizeof(one)) < 0)
+        ALOGE("%s: failed to wake poll: %s", __func__, strerror(errno));
+}
+
+static bool shares_mpl_clock(int handle)
+{
+    return handle >= ID_MPL_BASE && handle <= ID_GR;
+}
+
+static bool is_fused(device_t *device, int handle)
+{
+    return device->fusion && (handle == ID_RV || handle == ID_GR || handle == ID_LA);
+}
+
+static bool feeds_fusion(int handle)
+{
+    return handle == ID_GY || handle == ID_A || handle == ID_M;
+}
+
+/*
+ * Bring the vendor device in line with what is active and asked for,
+ * including the raw sensors fusion needs and no fused sensor. The vendor
+ * is called without device->lock held.
+ */
+static int update_vendor(device_t *device)
+{
+    int64_t periods[ID_MAX];
+    int enables[ID_MAX];
+    int64_t fastest = 0;
+    int rv = 0;
+
+    {
+        android::Mutex::Autolock lock(device->lock);
+
+        device->fusing = false;
+        for (int handle = 0; handle < ID_MAX; handle++) {
+            sensor_state_t *sensor = &device->sensors[handle];
+            if (sensor->active && is_fused(device, handle))
+                device->fusing = true;
+            if (sensor->active && sensor->period_ns && shares_mpl_clock(handle) &&
+                    (!fastest || sensor->period_ns < fastest))
+                fastest = sensor->period_ns;
+        }
+
+        for (int handle = 0; handle < ID_MAX; handle++) {
+            sensor_state_t *sensor = &device->sensors[handle];
+            int64_t period = sensor->period_ns;
+            bool on = !is_fused(device, handle) &&
+                    (sensor->active || (device->fusing && feeds_fusion(handle)));
+
+            if (on && fastest && shares_mpl_clock(handle))
+                period = fastest;
+            periods[handle] = !is_fused(device, handle) && period != sensor->vendor_period_ns ?
+                    period : 0;
+            if (periods[handle])
+                sensor->vendor_period_ns = period;
+            enables[handle] = on != sensor->vendor_active ? on : -1;
+            sensor->vendor_active = on;
+        }
+    }
+
+    for (int handle = 0; handle < ID_MAX; handle++) {
+        int err;
+
+        if (!find_sensor(handle))
+            continue;
+        if (periods[handle]) {
+            err = device->vendor.device->setDelay(device->vendor.device, handle,
+                    periods[handle]);
+            if (err)
+                rv = err;
+        }
+        if (enables[handle] >= 0) {
+            err = device->vendor.device->activate(device->vendor.device, handle,
+                    enables[handle]);
+            if (err) {
+                android::Mutex::Autolock lock(device->lock);
+                device->sensors[handle].vendor_active = !enables[handle];
+                rv = err;
+            }
+        }
+    }
+
+    return rv;
+}
+
 static int activate(struct sensors_poll_device_t *dev, int sensor_handle, int enabled)
 {
     device_t *device = (device_t *) dev;
+    int rv;
+
+    if (!find_sensor(sensor_handle))
+        return -EINVAL;
 
-    return device->vendor.device->activate(device->vendor.device, sensor_handle, enabled);
+    {
+        android::Mutex::Autolock lock(device->lock);
+        sensor_state_t *sensor = &device->sensors[sensor_handle];
+        if (enabled && is_fused(device, sensor_handle) && !device->fusing) {
+            device->fusion_filter.reset();
+            memset(device->accel, 0, sizeof(device->accel));
+            memset(device->mag, 0, sizeof(device->mag));
+            device->gyro_ns = 0;
+        }
+        sensor->active = enabled;
+        sensor->last_ns = 0;
+        sensor->samples = 0;
+        if (sensor_handle == ID_L) {
+            if (!enabled && device->light_filter.seen())
+                ALOGD("light: %llu of %llu events suppressed",
+                        (unsigned long long) device->light_filter.suppressed(),
+                        (unsigned long long) device->light_filter.seen());
+            device->light_filter.reset();
+        }
+        if (!enabled) {
+            sensor->fifo.clear();
+            sensor->deadline_ns = 0;
+            sensor->flushes = 0;
+        }
+    }
+
+    rv = update_vendor(device);
+    if (rv && enabled) {
+        android::Mutex::Autolock lock(device->lock);
+        device->sensors[sensor_handle].active = false;
+    }
+
+    return rv;
 }
+
+static int set_period(device_t *device, int sensor_handle, int64_t sampling_period_ns)
+{
+    {
+        android::Mutex::Autolock lock(device->lock);
+        device->sensors[sensor_handle].period_ns = sampling_period_ns;
+    }
+
+    return update_vendor(device);
+}
+
 static int setDelay(struct sensors_poll_device_t *dev, int sensor_handle, int64_t sampling_period_ns)
 {
     device_t *device = (device_t *) dev;
 
-    return device->vendor.device->setDelay(device->vendor.device, sensor_handle, sampling_period_ns);
+    if (!find_sensor(sensor_handle))
+        return -EINVAL;
+
+    return set_period(device, sensor_handle, sampling_period_ns);
 }
+
+static int batch(struct sensors_poll_device_1 *dev, int sensor_handle, int flags,
+        int64_t sampling_period_ns, int64_t max_report_latency_ns)
+{
+    device_t *device = (device_t *) dev;
+    const struct sensor_t *info = find_sensor(sensor_handle);
+    int rv;
+
+    if (!info)
+        return -EINVAL;
+    /* Sensors without a FIFO just report as they go. */
+    if (!info->fifoMaxEventCount)
+        max_report_latency_ns = 0;
+    if (flags & SENSORS_BATCH_DRY_RUN)
+        return 0;
+
+    rv = set_period(device, sensor_handle, sampling_period_ns);
+    if (rv)
+        return rv;
+
+    android::Mutex::Autolock lock(device->lock);
+    sensor_state_t *sensor = &device->sensors[sensor_handle];
+    sensor->latency_ns = max_report_latency_ns;
+    /* Do not hold what is buffered for longer than the new latency. */
+    if (!sensor->fifo.empty()) {
+        int64_t deadline = now_ns() + max_report_latency_ns;
+        if (deadline < sensor->deadline_ns) {
+            sensor->deadline_ns = deadline;
+            /* poll() may be asleep on the old deadline. */
+            wake_poll(device);
+        }
+    }
+
+    return 0;
+}
+
+static int flush(struct sensors_poll_device_1 *dev, int sensor_handle)
+{
+    device_t *device = (device_t *) dev;
+    const struct sensor_t *info = find_sensor(sensor_handle);
+
+    if (!info || (info->flags & REPORTING_MODE_MASK) == SENSOR_FLAG_ONE_SHOT_MODE)
+        return -EINVAL;
+
+    android::Mutex::Autolock lock(device->lock);
+    sensor_state_t *sensor = &device->sensors[sensor_handle];
+    if (!sensor->active)
+        return -EINVAL;
+
+    sensor->flushes++;
+    sensor->flush_pos = device->ring.pushed();
+    wake_poll(device);
+    return 0;
+}
+
+/*
+ * Move whatever is due out of the FIFOs: buffered events once the oldest
+ * has waited long enough or the FIFO is full, and everything followed by
+ * a flush complete event when a flush is pending and the ring has been
+ * consumed past it. Must be called with device->lock held.
+ */
+static int drain(device_t *device, sensors_event_t *data, int count)
+{
+    int64_t now = now_ns();
+    uint32_t popped = device->ring.popped();
+    sensor_state_t *light = &device->sensors[ID_L];
+    sensors_event_t held;
+    int n = 0;
+
+    /* A light reading held back by the filter goes out once it is due. */
+    if (light->active && (light->latency_ns || count > 0) &&
+            device->light_filter.release(now, light->flushes > 0, &held)) {
+        if (!light->latency_ns) {
+            data[n++] = held;
+        } else {
+            if (light->fifo.empty())
+                light->deadline_ns = now + light->latency_ns;
+            light->fifo.push(held);
+        }
+    }
+
+    for (int handle = 0; handle < ID_MAX && n < count; handle++) {
+        sensor_state_t *sensor = &device->sensors[handle];
+
+        if (!sensor->fifo.empty() && (sensor->flushes || sensor->fifo.full() ||
+                    now >= sensor->deadline_ns)) {
+            n += sensor->fifo.pop(data + n, count - n);
+            if (sensor->fifo.empty())
+                sensor->deadline_ns = 0;
+        }
+
+        while (sensor->flushes && sensor->fifo.empty() &&
+                (int32_t) (popped - sensor->flush_pos) >= 0 && n < count) {
+            sensors_event_t *event = &data[n++];
+
+            memset(event, 0, sizeof(*event));
+            event->version = META_DATA_VERSION;
+            event->type = SENSOR_TYPE_META_DATA;
+            event->meta_data.what = META_DATA_FLUSH_COMPLETE;
+            event->meta_data.sensor = handle;
+            sensor->flushes--;
+        }
+    }
+
+    return n;
+}
+
+static bool averages_samples(int type)
+{
+    return type == SENSOR_TYPE_ACCELEROMETER || type == SENSOR_TYPE_GYROSCOPE ||
+            type == SENSOR_TYPE_MAGNETIC_FIELD;
+}
+
+/*
+ * Whether an event is due for its stream's period. Raw samples that are
+ * not due are folded into the next one that is. Only continuous sensors
+ * are decimated: an on-change reading dropped here might never be
+ * followed by another. Must be called with device->lock held.
+ */
+static bool decimate(sensor_state_t *sensor, sensors_event_t *event)
+{
+    const struct sensor_t *info = find_sensor(event->sensor);
+    bool average = averages_samples(event->type);
+
+    if (!sensor->period_ns || !info ||
+            (info->flags & REPORTING_MODE_MASK) != SENSOR_FLAG_CONTINUOUS_MODE)
+        return true;
+
+    if (average) {
+        for (int i = 0; i < 3; i++)
+            sensor->sum[i] += event->data[i];
+        sensor->samples++;
+    }
+
+    if (sensor->last_ns && event->timestamp - sensor->last_ns <
+            sensor->period_ns - sensor->period_ns / PERIOD_SLACK_DIV)
+        return false;
+
+    if (average && sensor->samples > 1) {
+        for (int i = 0; i < 3; i++)
+            event->data[i] = sensor->sum[i] / sensor->samples;
+    }
+
+    memset(sensor->sum, 0, sizeof(sensor->sum));
+    sensor->samples = 0;
+    sensor->last_ns = event->timestamp;
+    return true;
+}
+
+/*
+ * Fuse the collected gyro samples and queue the fused sensors' events in
+ * their FIFOs, due at once unless they are batched. Must be called with
+ * device->lock held.
+ */
+static void run_fusion(device_t *device, const FusionSample *samples,
+        const int64_t *timestamps, int count)
+{
+    static const int fused[] = { ID_RV, ID_GR, ID_LA };
+    float q[FUSION_BATCH][4];
+    int64_t now = now_ns();
+
+    device->fusion_filter.update(samples, count, q);
+
+    for (size_t j = 0; j < ARRAY_SIZE(fused); j++) {
+        int handle = fused[j];
+        sensor_state_t *sensor = &device->sensors[handle];
+
+        if (!sensor->active)
+            continue;
+
+        for (int i = 0; i < count; i++) {
+            sensors_event_t event;
+
+            memset(&event, 0, sizeof(event));
+            event.version = sizeof(event);
+            event.sensor = handle;
+            event.type = find_sensor(handle)->type;
+            event.timestamp = timestamps[i];
+
+            if (handle == ID_RV) {
+                Fusion::rotationVector(q[i], event.data);
+                /* No estimate of the heading accuracy. */
+                event.data[4] = -1.0f;
+            } else {
+                Fusion::gravity(q[i], event.data);
+                if (handle == ID_LA) {
+                    for (int k = 0; k < 3; k++)
+                        event.data[k] = samples[i].accel[k] - event.data[k];
+                }
+                event.acceleration.status = SENSOR_STATUS_ACCURACY_HIGH;
+            }
+
+            if (!decimate(sensor, &event))
+                continue;
+            if (sensor->fifo.empty())
+                sensor->deadline_ns = now + sensor->latency_ns;
+            sensor->fifo.push(event);
+        }
+    }
+}
+
+/*
+ * Keep the latest accel and mag readings and turn each gyro event into a
+ * fusion sample. Returns how many samples are now pending. Must be
+ * called with device->lock held.
+ */
+static int feed_fusion(device_t *device, const sensors_event_t *event,
+        FusionSample *samples, int64_t *timestamps, int count)
+{
+    FusionSample *sample;
+
+    if (event->sensor == ID_A) {
+        memcpy(device->accel, event->data, sizeof(device->accel));
+        return count;
+    }
+    if (event->sensor == ID_M) {
+        memcpy(device->mag, event->data, sizeof(device->mag));
+        return count;
+    }
+
+    /* The filter starts from accel, so wait for a reading. */
+    if (!device->accel[0] && !device->accel[1] && !device->accel[2])
+        return count;
+
+    if (device->gyro_ns && event->timestamp - device->gyro_ns > FUSION_MAX_GAP_NS) {
+        if (count)
+            run_fusion(device, samples, timestamps, count);
+        count = 0;
+        device->fusion_filter.reset();
+        device->gyro_ns = 0;
+    }
+
+    sample = &samples[count];
+    memcpy(sample->gyro, event->data, sizeof(sample->gyro));
+    memcpy(sample->accel, device->accel, sizeof(sample->accel));
+    memcpy(sample->mag, device->mag, sizeof(sample->mag));
+    sample->dt = device->gyro_ns ? (event->timestamp - device->gyro_ns) / 1e9f : 0.0f;
+    timestamps[count++] = event->timestamp;
+    device->gyro_ns = event->timestamp;
+
+    if (count == FUSION_BATCH) {
+        run_fusion(device, samples, timestamps, count);
+        count = 0;
+    }
+
+    return count;
+}
+
+/*
+ * Sort freshly read vendor events in place: events early for their
+ * stream or within the light hysteresis are dropped, those of sensors
+ * reporting as they go stay in data and the rest go to their FIFO. Raw
+ * events are fused first when a fused sensor is active, and only kept if
+ * their own sensor is. Returns how many stayed. Must be called with
+ * device->lock held.
+ */
+static int buffer_events(device_t *device, sensors_event_t *data, int count)
+{
+    FusionSample samples[FUSION_BATCH];
+    int64_t timestamps[FUSION_BATCH];
+    int fused = 0;
+    int n = 0;
+
+    for (int i = 0; i < count; i++) {
+        int handle = data[i].sensor;
+        sensor_state_t *sensor;
+
+        if (data[i].type == SENSOR_TYPE_META_DATA || handle < 0 || handle >= ID_MAX) {
+            data[n++] = data[i];
+            continue;
+        }
+
+        if (device->fusing && feeds_fusion(handle))
+            fused = feed_fusion(device, &data[i], samples, timestamps, fused);
+
+        sensor = &device->sensors[handle];
+        if (!sensor->active || !decimate(sensor, &data[i]))
+            continue;
+        if (handle == ID_L && !device->light_filter.accept(data[i]))
+            continue;
+        if (!sensor->latency_ns) {
+            data[n++] = data[i];
+            continue;
+        }
+
+        if (sensor->fifo.empty())
+            sensor->deadline_ns = now_ns() + sensor->latency_ns;
+        sensor->fifo.push(data[i]);
+    }
+
+    if (fused)
+        run_fusion(device, samples, timestamps, fused);
+
+    return n;
+}
+
+/*
+ * How long poll() may sleep before a FIFO is due, -1 for as long as it
+ * takes. Must be called with device->lock held.
+ */
+static int poll_timeout_ms(device_t *device)
+{
+    int64_t deadline = 0;
+    int64_t wait;
+
+    for (int handle = 0; handle < ID_MAX; handle++) {
+        int64_t d = device->sensors[handle].deadline_ns;
+        if (d && (!deadline || d < deadline))
+            deadline = d;
+    }
+    if (device->sensors[ID_L].active) {
+        int64_t d = device->light_filter.deadline();
+        if (d && (!deadline || d < deadline))
+            deadline = d;
+    }
+
+    if (!deadline)
+        return -1;
+
+    wait = deadline - now_ns();
+    /* Round up so we do not wake just before the deadline. */
+    return wait > 0 ? (int) ((wait + 999999) / 1000000) : 0;
+}
+
+static void log_overflows(device_t *device)
+{
+    uint32_t overflows = device->ring.overflows();
+
+    if (overflows != device->overflows_logged) {
+        device->overflows_logged = overflows;
+        ALOGW("event ring of %zu overflowed %u times, %llu events dropped",
+                device->ring.capacity(), overflows,
+                (unsigned long long) device->ring.dropped());
+    }
+}
+
 static int poll(struct sensors_poll_device_t *dev, sensors_event_t* data, int count)
 {
     device_t *device = (device_t *) dev;
+    struct pollfd pfd;
+    uint64_t wakeups;
+    int n, popped, timeout;
+
+    pfd.fd = device->wake_fd;
+    pfd.events = POLLIN;
+
+    /*
+     * Sort what the reader queued into the FIFOs before draining them, so
+     * a flush complete never overtakes events read before the flush.
+     */
+    for (;;) {
+        popped = device->ring.pop(data, count);
+        if (popped)
+            log_overflows(device);
+
+        {
+            android::Mutex::Autolock lock(device->lock);
+            n = popped ? buffer_events(device, data, popped) : 0;
+            n += drain(device, data + n, count - n);
+            if (n)
+                return n;
+            /* Everything popped was held back; there may be more queued. */
+            if (popped)
+                continue;
+            timeout = poll_timeout_ms(device);
+        }
+        if (::poll(&pfd, 1, timeout) > 0 &&
+                read(device->wake_fd, &wakeups, sizeof(wakeups)) < 0 && errno != EAGAIN)
+            return -errno;
+    }
+}
+
+static void *reader_loop(void *arg)
+{
+    device_t *device = (device_t *) arg;
+    sensors_event_t events[VENDOR_READ_EVENTS];
+    int n;
+
+    while (!device->stop) {
+        n = device->vendor.device->poll(device->vendor.device, events, VENDOR_READ_EVENTS);
+        if (n < 0) {
+            ALOGE("%s: vendor poll failed: %d", __func__, n);
+            /* Do not spin if the vendor device is broken. */
+            usleep(100000);
+            continue;
+        }
+        if (n) {
+            device->ring.push(events, n);
+            wake_poll(device);
+        }
+    }
 
-    return device->vendor.device->poll(device->vendor.device, data, count);
+    return NULL;
 }
 
 static int device_close(hw_device_t *hw_device)
 {
     device_t *device = (device_t *) hw_device;
-    int rv = device->base.common.close(device->vendor.hw_device);
-    free(device);
+    int rv;
+
+    /*
+     * The reader only notices once the vendor poll returns, which it
+     * does as long as any sensor is active.
+     */
+    device->stop = true;
+    if (device->reader_running)
+        pthread_join(device->reader, NULL);
+
+    rv = device->vendor.hw_device->close(device->vendor.hw_device);
+    close(device->wake_fd);
+    delete device;
     return rv;
 }
 
+static int property_get_int(const char *key, int def)
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    if (property_get(key, value, "") <= 0)
+        return def;
+    return atoi(value);
+}
+
 static int device_open(const hw_module_t *module, const char *name, hw_device_t **device_out)
 {
     int rv;
@@ -113,26 +794,74 @@ static int device_open(const hw_module_t *module, const char *name, hw_device_t
         return -EINVAL;
     }
 
-    device = (device_t *) calloc(sizeof(*device), 1);
+    device = new (std::nothrow) device_t();
     if (!device) {
         ALOGE("%s: Failed to allocate memory", __func__);
         return -ENOMEM;
     }
 
+    for (size_t i = 0; i < ARRAY_SIZE(sSensorList); i++) {
+        if (!device->sensors[sSensorList[i].handle].fifo.init(
+                    sSensorList[i].fifoReservedEventCount)) {
+            ALOGE("%s: Failed to allocate FIFO for %s", __func__, sSensorList[i].name);
+            delete device;
+            return -ENOMEM;
+        }
+    }
+
+    device->fusion = property_get_int(FUSION_PROP, 0) != 0;
+    if (device->fusion)
+        ALOGI("fusing rotation vector, gravity and linear accel in software");
+
+    device->light_filter.configure(
+            property_get_int(LIGHT_RELATIVE_PROP, DEFAULT_LIGHT_RELATIVE_PCT) / 100.0f,
+            property_get_int(LIGHT_ABSOLUTE_PROP, DEFAULT_LIGHT_ABSOLUTE_LUX),
+            property_get_int(LIGHT_INTERVAL_PROP, DEFAULT_LIGHT_INTERVAL_MS) * 1000000LL);
+
+    char ring_size[PROPERTY_VALUE_MAX];
+    property_get(RING_SIZE_PROP, ring_size, "");
+    size_t ring_events = atoi(ring_size) > 0 ? atoi(ring_size) : DEFAULT_RING_SIZE;
+    if (!device->ring.init(ring_events)) {
+        ALOGE("%s: Failed to allocate event ring of %zu", __func__, ring_events);
+        delete device;
+        return -ENOMEM;
+    }
+
+    device->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (device->wake_fd < 0) {
+        rv = -errno;
+        ALOGE("%s: failed to create eventfd: %s", __func__, strerror(errno));
+        delete device;
+        return rv;
+    }
+
     rv = vendor.module->common.methods->open(vendor.hw_module, name, &device->vendor.hw_device);
     if (rv) {
         ALOGE("%s: failed to open, error %d\n", __func__, rv);
-        free(device);
+        close(device->wake_fd);
+        delete device;
         return rv;
     }
 
+    rv = pthread_create(&device->reader, NULL, reader_loop, device);
+    if (rv) {
+        ALOGE("%s: failed to start reader thread, error %d\n", __func__, rv);
+        device->vendor.hw_device->close(device->vendor.hw_device);
+        close(device->wake_fd);
+        delete device;
+        return -rv;
+    }
+    device->reader_running = true;
+
     device->base.common.tag = HARDWARE_DEVICE_TAG;
-    device->base.common.version  = SENSORS_DEVICE_API_VERSION_1_0;
+    device->base.common.version  = SENSORS_DEVICE_API_VERSION_1_3;
     device->base.common.module   = const_cast<hw_module_t*>(module);
     device->base.common.close    = device_close;
     device->base.activate        = activate;
     device->base.setDelay        = setDelay;
     device->base.poll            = poll;
+    device->base.batch           = batch;
+    device->base.flush           = flush;
 
     *device_out = (hw_device_t *) device;
     return 0;
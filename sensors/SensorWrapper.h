@@ -35,57 +35,84 @@
 #define ID_T  (ID_P + 1)
 #define ID_AP (ID_P +1) /* Atomospheric Pressure */
 
+#define ID_MAX (ID_AP + 1)
+
 #ifndef ANDROID_MPL_SENSOR_DEFS_H
 #define ANDROID_MPL_SENSOR_DEFS_H
 
+/*
+ * The MPL has no hardware FIFO; SensorWrapper emulates one per sensor of
+ * fifoReservedEventCount events to support batching. Raw sensors get
+ * room for a few seconds at the rates pedometers and fitness apps use.
+ */
+#define MPL_RAW_FIFO_EVENTS 600
+#define MPL_MAG_FIFO_EVENTS 300
+#define MPL_FUSION_FIFO_EVENTS 100
+/* Slowest sampling period accepted, in us. */
+#define MPL_MAX_DELAY 200000
+
 #define MPLROTATIONVECTOR_DEF {                         \
     "MPL rotation vector",                              \
     "Invensense",                                       \
     1, ID_RV,                                           \
     SENSOR_TYPE_ROTATION_VECTOR, 1.0f, 0.00001f,        \
-    15.5f, 5000, 0, 0, 0, 0, 0, 0, { } }
+    15.5f, 5000,                                        \
+    MPL_FUSION_FIFO_EVENTS, MPL_FUSION_FIFO_EVENTS,     \
+    0, 0, MPL_MAX_DELAY, SENSOR_FLAG_CONTINUOUS_MODE, { } }
 
 #define MPLLINEARACCEL_DEF {                            \
     "MPL linear accel",                                 \
     "Invensense",                                       \
     1, ID_LA,                                           \
     SENSOR_TYPE_LINEAR_ACCELERATION, 20.0f, 0.04f,      \
-    15.5f, 5000, 0, 0, 0, 0, 0, 0, { } }
+    15.5f, 5000,                                        \
+    MPL_FUSION_FIFO_EVENTS, MPL_FUSION_FIFO_EVENTS,     \
+    0, 0, MPL_MAX_DELAY, SENSOR_FLAG_CONTINUOUS_MODE, { } }
 
 #define MPLGRAVITY_DEF {                                \
     "MPL gravity",                                      \
     "Invensense",                                       \
     1, ID_GR,                                           \
     SENSOR_TYPE_GRAVITY, 9.81f, 0.00001f,               \
-    15.5f, 5000, 0, 0, 0, 0, 0, 0, { } }
+    15.5f, 5000,                                        \
+    MPL_FUSION_FIFO_EVENTS, MPL_FUSION_FIFO_EVENTS,     \
+    0, 0, MPL_MAX_DELAY, SENSOR_FLAG_CONTINUOUS_MODE, { } }
 
 #define MPLGYRO_DEF {                                   \
     "MPL Gyro",                                         \
     "Invensense",                                       \
     1, ID_GY,                                           \
     SENSOR_TYPE_GYROSCOPE, 35.0f, 0.001f,               \
-    5.5f, 5000, 0, 0, 0, 0, 0, 0, { } }
+    5.5f, 5000,                                         \
+    MPL_RAW_FIFO_EVENTS, MPL_RAW_FIFO_EVENTS,           \
+    0, 0, MPL_MAX_DELAY, SENSOR_FLAG_CONTINUOUS_MODE, { } }
 
 #define MPLACCEL_DEF {                                  \
     "MPL accel",                                        \
     "Invensense",                                       \
     1, ID_A,                                            \
     SENSOR_TYPE_ACCELEROMETER, 20.0f, 0.04f,            \
-    0.0f, 5000, 0, 0, 0, 0, 0, 0, { } }
+    0.0f, 5000,                                         \
+    MPL_RAW_FIFO_EVENTS, MPL_RAW_FIFO_EVENTS,           \
+    0, 0, MPL_MAX_DELAY, SENSOR_FLAG_CONTINUOUS_MODE, { } }
 
 #define MPLMAGNETICFIELD_DEF {                          \
     "MPL magnetic field",                               \
     "Invensense",                                       \
     1, ID_M,                                            \
     SENSOR_TYPE_MAGNETIC_FIELD, 9830.0f, 0.285f,        \
-    10.0f, 10000, 0, 0, 0, 0, 0, 0, { } }
+    10.0f, 10000,                                       \
+    MPL_MAG_FIFO_EVENTS, MPL_MAG_FIFO_EVENTS,           \
+    0, 0, MPL_MAX_DELAY, SENSOR_FLAG_CONTINUOUS_MODE, { } }
 
 #define MPLORIENTATION_DEF {                            \
     "MPL Orientation",                                  \
     "Invensense",                                       \
     1, ID_O,                                            \
     SENSOR_TYPE_ORIENTATION, 360.0f, 0.00001f,          \
-    15.5f, 5000, 0, 0, 0, 0, 0, 0, { } }
+    15.5f, 5000,                                        \
+    MPL_FUSION_FIFO_EVENTS, MPL_FUSION_FIFO_EVENTS,     \
+    0, 0, MPL_MAX_DELAY, SENSOR_FLAG_CONTINUOUS_MODE, { } }
 
 #endif
 
@@ -97,6 +124,7 @@
     "Capella Microsystems",                   \
     1, ID_L,                                  \
     SENSOR_TYPE_LIGHT, 20480.0f, 1.0f,        \
-    0.5f, 0, 0, 0, 0, 0, 0, 0,  { } }
+    0.5f, 0, 0, 0, 0, 0, 0,                   \
+    SENSOR_FLAG_ON_CHANGE_MODE, { } }
 
 #endif  // ANDROID_LIGHT_SENSOR_H
\ No newline at end of file
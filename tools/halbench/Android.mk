@@ -0,0 +1,80 @@
+# Copyright (C) 2026 FG6Q-Dev
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+LOCAL_PATH := $(call my-dir)
+
+# Host benchmark for the power and lights HALs against a fake sysfs tree:
+#   halbench -p power.macallan_host.so -l lights.macallan_host.so
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    halbench.c \
+    fakesysfs.c
+LOCAL_LDLIBS := -ldl
+LOCAL_MODULE := halbench
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Replays a trace recorded with debug.power.trace against the fake sysfs
+# tree, or against the live device with -L:
+#   hintreplay [-L] [-p power.so] [-t tunables.conf] [-s speed] trace.bin
+hintreplay_src_files := \
+    hintreplay.c \
+    fakesysfs.c
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := $(hintreplay_src_files)
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../../power
+LOCAL_LDLIBS := -ldl
+LOCAL_MODULE := hintreplay
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := $(hintreplay_src_files)
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../../power
+LOCAL_SHARED_LIBRARIES := libdl
+LOCAL_MODULE := hintreplay
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
+
+# Per-sample cost of the sensors wrapper's vector fusion path against its
+# scalar reference, on a synthetic recording:
+#   fusionbench [-n samples] [-r rate_hz] [-b batch]
+fusionbench_src_files := \
+    fusionbench.cpp \
+    ../../sensors/Fusion.cpp
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := $(fusionbench_src_files)
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../../sensors
+LOCAL_MODULE := fusionbench
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := $(fusionbench_src_files)
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../../sensors
+LOCAL_MODULE := fusionbench
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_EXECUTABLE)
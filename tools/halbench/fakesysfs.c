@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "fakesysfs.h"
+
+#define INTERACTIVE "/sys/devices/system/cpu/cpufreq/interactive/"
+#define CPU0_CPUFREQ "/sys/devices/system/cpu/cpu0/cpufreq/"
+#define SMARTDIMMER "/sys/class/graphics/fb0/device/smartdimmer/"
+
+struct fake_node {
+    const char *path;
+    const char *value;
+};
+
+/*
+ * Initial contents roughly as found on a booted device. Unlike real sysfs
+ * attributes these are plain files, so a short pwrite() at offset 0 leaves
+ * the tail of a longer previous value behind; the HALs never read back
+ * what they wrote, so that does not matter here.
+ */
+static const struct fake_node fake_nodes[] = {
+    { INTERACTIVE "timer_rate", "20000" },
+    { INTERACTIVE "timer_slack", "80000" },
+    { INTERACTIVE "min_sample_time", "80000" },
+    { INTERACTIVE "hispeed_freq", "696000" },
+    { INTERACTIVE "go_hispeed_load", "99" },
+    { INTERACTIVE "target_loads", "75 228000:85 696000:90 1530000:95" },
+    { INTERACTIVE "above_hispeed_delay", "20000 1530000:50000" },
+    { INTERACTIVE "boostpulse_duration", "80000" },
+    { INTERACTIVE "io_is_busy", "1" },
+    { INTERACTIVE "boostpulse", "" },
+    { CPU0_CPUFREQ "scaling_max_freq", "1810500" },
+    { CPU0_CPUFREQ "scaling_min_freq", "51000" },
+    { CPU0_CPUFREQ "cpuinfo_min_freq", "51000" },
+    { CPU0_CPUFREQ "stats/time_in_state", "51000 1200\n204000 300\n696000 150\n1224000 80\n1810500 20" },
+    { "/sys/devices/platform/host1x/nvavp/boost_sclk", "0" },
+    { "/sys/module/cpu_tegra/parameters/cpu_user_cap", "0" },
+    { "/sys/devices/system/cpu/online", "0" },
+    { "/sys/kernel/cluster/active", "G" },
+    { "/sys/power/wake_lock", "" },
+    { "/sys/power/wake_unlock", "" },
+    { "/dev/max_online_cpus", "" },
+    { "/dev/emc_freq_min", "" },
+    { "/dev/gpu_freq_min", "" },
+    { "/sys/class/input/input0/name", "raydium_ts" },
+    { "/sys/class/input/input0/enabled", "1" },
+    { "/sys/class/input/input1/name", "sensor00fn11" },
+    { "/sys/class/input/input1/enabled", "1" },
+    { "/sys/class/input/input2/name", "gpio-keys" },
+    { "/sys/class/input/input2/enabled", "1" },
+    { "/sys/class/input/input3/name", "tegra-kbc" },
+    { "/sys/class/input/input3/enabled", "1" },
+    { "/sys/class/backlight/pwm-backlight/brightness", "128" },
+    { "/sys/class/thermal/thermal_zone0/type", "tegra-therm" },
+    { "/sys/class/thermal/thermal_zone0/temp", "45000" },
+    { "/sys/class/graphics/fb0/modes", "U:2560x1600p-60" },
+    { SMARTDIMMER "enable", "1" },
+    { SMARTDIMMER "aggressiveness", "27" },
+};
+
+static int mkdirs(char *path)
+{
+    char *p;
+
+    for (p = strchr(path + 1, '/'); p; p = strchr(p + 1, '/')) {
+        *p = '\0';
+        if (mkdir(path, 0755) && errno != EEXIST) {
+            *p = '/';
+            return -1;
+        }
+        *p = '/';
+    }
+
+    return 0;
+}
+
+static int create_node(const char *root, const struct fake_node *node)
+{
+    char path[512];
+    int fd;
+
+    snprintf(path, sizeof(path), "%s%s", root, node->path);
+    if (mkdirs(path))
+        return -1;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+
+    if (write(fd, node->value, strlen(node->value)) < 0 || write(fd, "\n", 1) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+int fakesysfs_create(char *root, size_t size)
+{
+    size_t i;
+
+    /* /dev/shm is tmpfs on any common distro, keeping disk I/O out of it. */
+    snprintf(root, size, "/dev/shm/macallan-sysfs.XXXXXX");
+    if (!mkdtemp(root)) {
+        snprintf(root, size, "/tmp/macallan-sysfs.XXXXXX");
+        if (!mkdtemp(root)) {
+            /* On the device itself. */
+            snprintf(root, size, "/data/local/tmp/macallan-sysfs.XXXXXX");
+            if (!mkdtemp(root))
+                return -errno;
+        }
+    }
+
+    for (i = 0; i < sizeof(fake_nodes) / sizeof(fake_nodes[0]); i++) {
+        if (create_node(root, &fake_nodes[i])) {
+            fprintf(stderr, "failed to create %s%s: %s\n", root,
+                    fake_nodes[i].path, strerror(errno));
+            fakesysfs_destroy(root);
+            return -errno;
+        }
+    }
+
+    return 0;
+}
+
+static int remove_entry(const char *path, const struct stat *sb, int type,
+        struct FTW *ftw)
+{
+    return remove(path);
+}
+
+void fakesysfs_destroy(const char *root)
+{
+    nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
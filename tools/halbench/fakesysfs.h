@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MACALLAN_FAKESYSFS_H
+#define MACALLAN_FAKESYSFS_H
+
+#include <stddef.h>
+
+/*
+ * Build a throwaway tree mirroring the Macallan sysfs nodes touched by the
+ * power and lights HALs, preferably on tmpfs. The HALs are pointed at it
+ * through MACALLAN_SYSFS_ROOT.
+ */
+int fakesysfs_create(char *root, size_t size);
+void fakesysfs_destroy(const char *root);
+
+#endif // MACALLAN_FAKESYSFS_H
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Runs the sensors wrapper's fusion filter over a synthetic recording of
+ * a device turning in a magnetic field and reports the cost per sample
+ * of the vector path against the scalar reference, how far apart the two
+ * end up and how far each is from the true orientation.
+ *
+ * usage: fusionbench [-n samples] [-r rate_hz] [-b batch]
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Fusion.h"
+
+#define DEFAULT_SAMPLES 200000
+#define DEFAULT_RATE_HZ 200
+/* Events the wrapper reads from the vendor device at a time. */
+#define DEFAULT_BATCH 64
+#define RUNS 5
+
+#define GRAVITY_EARTH 9.80665f
+/* Earth field in north, west, up: 50 uT dipping 60 degrees. */
+static const float earth_field[3] = { 25.0f, 0.0f, -43.3f };
+static const float gyro_bias[3] = { 0.01f, -0.005f, 0.008f };
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Cheap repeatable noise, roughly normal with the given deviation. */
+static float noise(float sigma)
+{
+    static uint32_t state = 12345;
+    float sum = 0.0f;
+
+    for (int i = 0; i < 4; i++) {
+        state = state * 1664525u + 1013904223u;
+        sum += (state >> 8) / 16777216.0f - 0.5f;
+    }
+    return sum * sigma * 1.732f;
+}
+
+/* v in device coordinates for a device at orientation q. */
+static void to_device(const double q[4], const float v[3], float out[3])
+{
+    double r[3][3] = {
+        { 1 - 2 * (q[2] * q[2] + q[3] * q[3]), 2 * (q[1] * q[2] - q[0] * q[3]),
+                2 * (q[1] * q[3] + q[0] * q[2]) },
+        { 2 * (q[1] * q[2] + q[0] * q[3]), 1 - 2 * (q[1] * q[1] + q[3] * q[3]),
+                2 * (q[2] * q[3] - q[0] * q[1]) },
+        { 2 * (q[1] * q[3] - q[0] * q[2]), 2 * (q[2] * q[3] + q[0] * q[1]),
+                1 - 2 * (q[1] * q[1] + q[2] * q[2]) },
+    };
+
+    for (int i = 0; i < 3; i++)
+        out[i] = (float) (r[0][i] * v[0] + r[1][i] * v[1] + r[2][i] * v[2]);
+}
+
+/* Turn q by the body rates w for dt seconds. */
+static void rotate(double q[4], const double w[3], double dt)
+{
+    double angle = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]) * dt;
+    double s, c, d[4], r[4], norm;
+
+    if (angle == 0.0)
+        return;
+    s = sin(angle / 2) / (angle / dt);
+    c = cos(angle / 2);
+    d[0] = c;
+    d[1] = w[0] * s;
+    d[2] = w[1] * s;
+    d[3] = w[2] * s;
+
+    r[0] = q[0] * d[0] - q[1] * d[1] - q[2] * d[2] - q[3] * d[3];
+    r[1] = q[0] * d[1] + q[1] * d[0] + q[2] * d[3] - q[3] * d[2];
+    r[2] = q[0] * d[2] - q[1] * d[3] + q[2] * d[0] + q[3] * d[1];
+    r[3] = q[0] * d[3] + q[1] * d[2] - q[2] * d[1] + q[3] * d[0];
+    norm = sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+    for (int i = 0; i < 4; i++)
+        q[i] = r[i] / norm;
+}
+
+static void record(FusionSample *samples, float (*truth)[4], int count, int rate)
+{
+    const float gravity[3] = { 0.0f, 0.0f, GRAVITY_EARTH };
+    double q[4] = { 1.0, 0.0, 0.0, 0.0 };
+    double dt = 1.0 / rate;
+
+    for (int i = 0; i < count; i++) {
+        double t = i * dt;
+        double w[3] = { 0.5 * sin(1.3 * t), 0.8 * sin(0.7 * t), 1.2 * cos(0.4 * t) };
+        FusionSample *s = &samples[i];
+
+        /* Integrate finely so the truth does not carry our own error. */
+        for (int step = 0; step < 10; step++)
+            rotate(q, w, dt / 10);
+
+        to_device(q, gravity, s->accel);
+        to_device(q, earth_field, s->mag);
+        for (int j = 0; j < 3; j++) {
+            s->gyro[j] = (float) w[j] + gyro_bias[j] + noise(0.005f);
+            s->accel[j] += noise(0.05f);
+            s->mag[j] += noise(0.5f);
+        }
+        s->dt = (float) dt;
+        for (int j = 0; j < 4; j++)
+            truth[i][j] = (float) q[j];
+    }
+}
+
+static float angle_deg(const float a[4], const float b[4])
+{
+    float d = fabsf(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+
+    return 2.0f * acosf(d > 1.0f ? 1.0f : d) * 180.0f / (float) M_PI;
+}
+
+typedef void (Fusion::*update_fn)(const FusionSample *, size_t, float (*)[4]);
+
+/* Best time per sample over RUNS passes, leaving the orientations in out. */
+static double run(update_fn update, const FusionSample *samples, int count, int batch,
+        float (*out)[4])
+{
+    double best = 0.0;
+
+    for (int pass = 0; pass < RUNS; pass++) {
+        Fusion fusion;
+        int64_t start = now_ns();
+
+        for (int i = 0; i < count; i += batch) {
+            int n = count - i < batch ? count - i : batch;
+            (fusion.*update)(samples + i, n, out + i);
+        }
+
+        double ns = (double) (now_ns() - start) / count;
+        if (!pass || ns < best)
+            best = ns;
+    }
+
+    return best;
+}
+
+static void report(const char *name, double ns, float (*out)[4], float (*truth)[4],
+        int count, int rate)
+{
+    double sum = 0.0;
+    float max = 0.0f;
+    int settled = 0;
+
+    /* Skip the first couple of seconds while the filter settles. */
+    for (int i = 2 * rate; i < count; i++) {
+        float err = angle_deg(out[i], truth[i]);
+        sum += err * err;
+        if (err > max)
+            max = err;
+        settled++;
+    }
+
+    printf("%-8s %10.1f %12.2f %12.2f\n", name, ns,
+            settled ? sqrt(sum / settled) : 0.0, max);
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-n samples] [-r rate_hz] [-b batch]\n", argv0);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    FusionSample *samples;
+    float (*truth)[4], (*scalar)[4], (*vector)[4];
+    int count = DEFAULT_SAMPLES;
+    int rate = DEFAULT_RATE_HZ;
+    int batch = DEFAULT_BATCH;
+    double scalar_ns, vector_ns;
+    float diff = 0.0f;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:b:")) != -1) {
+        switch (opt) {
+            case 'n':
+                count = atoi(optarg);
+                break;
+            case 'r':
+                rate = atoi(optarg);
+                break;
+            case 'b':
+                batch = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (count <= 0 || rate <= 0 || batch <= 0)
+        usage(argv[0]);
+
+    samples = (FusionSample *) calloc(count, sizeof(*samples));
+    truth = (float (*)[4]) calloc(count, sizeof(*truth));
+    scalar = (float (*)[4]) calloc(count, sizeof(*scalar));
+    vector = (float (*)[4]) calloc(count, sizeof(*vector));
+    if (!samples || !truth || !scalar || !vector)
+        return 1;
+
+    record(samples, truth, count, rate);
+    scalar_ns = run(&Fusion::updateScalar, samples, count, batch, scalar);
+    vector_ns = run(&Fusion::update, samples, count, batch, vector);
+
+    /* Compared lane by lane: acos near 1 turns rounding into degrees. */
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < 4; j++) {
+            float d = fabsf(scalar[i][j] - vector[i][j]);
+            if (d > diff)
+                diff = d;
+        }
+    }
+
+    printf("%d samples at %d Hz in batches of %d\n\n", count, rate, batch);
+    printf("%-8s %10s %12s %12s\n", "path", "ns/sample", "rms err deg", "max err deg");
+    report("scalar", scalar_ns, scalar, truth, count, rate);
+    report("vector", vector_ns, vector, truth, count, rate);
+    printf("\nvector %.2fx scalar, quaternions differ by at most %.2g\n",
+            scalar_ns / vector_ns, diff);
+
+    free(samples);
+    free(truth);
+    free(scalar);
+    free(vector);
+    return 0;
+}
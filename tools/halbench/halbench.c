@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Drives the power and lights HALs against a fake sysfs tree and reports
+ * per-call latency percentiles and syscall counts for each entry point.
+ *
+ * usage: halbench [-n calls] [-p power.so] [-l lights.so]
+ */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <hardware/hardware.h>
+#include <hardware/lights.h>
+#include <hardware/power.h>
+
+#include "fakesysfs.h"
+
+#define DEFAULT_CALLS 10000
+#define DEFAULT_POWER_LIB "power.macallan_host.so"
+#define DEFAULT_LIGHTS_LIB "lights.macallan_host.so"
+
+/* Let worker threads in the HAL finish before sampling syscall counts. */
+#define SETTLE_US 100000
+
+struct syscounts {
+    unsigned long opens;
+    unsigned long closes;
+    unsigned long long reads;
+    unsigned long long writes;
+};
+
+/*
+ * open() and close() are interposed so calls made by the HALs are counted.
+ * Reads and writes of all flavours (including pwrite) come from the
+ * kernel's own per-process counters in /proc/self/io. stdio and opendir
+ * open files internally without going through these symbols, so those
+ * opens are not counted.
+ */
+static atomic_ulong open_calls;
+static atomic_ulong close_calls;
+
+int open(const char *path, int flags, ...)
+{
+    mode_t mode = 0;
+    va_list ap;
+
+    if (flags & O_CREAT) {
+        va_start(ap, flags);
+        mode = va_arg(ap, int);
+        va_end(ap);
+    }
+
+    atomic_fetch_add(&open_calls, 1);
+    return syscall(SYS_openat, AT_FDCWD, path, flags, mode);
+}
+
+int close(int fd)
+{
+    atomic_fetch_add(&close_calls, 1);
+    return syscall(SYS_close, fd);
+}
+
+static void sample_syscounts(struct syscounts *sc)
+{
+    char line[128];
+    FILE *f;
+
+    memset(sc, 0, sizeof(*sc));
+    sc->opens = atomic_load(&open_calls);
+    sc->closes = atomic_load(&close_calls);
+
+    f = fopen("/proc/self/io", "r");
+    if (!f)
+        return;
+    while (fgets(line, sizeof(line), f)) {
+        sscanf(line, "syscr: %llu", &sc->reads);
+        sscanf(line, "syscw: %llu", &sc->writes);
+    }
+    fclose(f);
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compare_ns(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *) a;
+    int64_t y = *(const int64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(const int64_t *sorted, int n, int pct)
+{
+    int idx = (int) ((int64_t) (n - 1) * pct / 100);
+
+    return sorted[idx] / 1000.0;
+}
+
+static void report(const char *name, int64_t *samples, int n,
+        const struct syscounts *before, const struct syscounts *after)
+{
+    qsort(samples, n, sizeof(*samples), compare_ns);
+
+    printf("%-22s %7d %9.2f %9.2f %9.2f %9.2f %8.2f %8.2f %8.2f %8.2f\n",
+            name, n,
+            percentile_us(samples, n, 50), percentile_us(samples, n, 90),
+            percentile_us(samples, n, 99), samples[n - 1] / 1000.0,
+            (double) (after->opens - before->opens) / n,
+            (double) (after->closes - before->closes) / n,
+            (double) (after->reads - before->reads) / n,
+            (double) (after->writes - before->writes) / n);
+}
+
+typedef void (*bench_fn)(void *ctx, int i);
+
+static void run(const char *name, bench_fn fn, void *ctx, int64_t *samples, int n)
+{
+    struct syscounts before, after;
+    int64_t start;
+    int i;
+
+    sample_syscounts(&before);
+    for (i = 0; i < n; i++) {
+        start = now_ns();
+        fn(ctx, i);
+        samples[i] = now_ns() - start;
+    }
+    usleep(SETTLE_US);
+    sample_syscounts(&after);
+
+    report(name, samples, n, &before, &after);
+}
+
+static void bench_set_interactive(void *ctx, int i)
+{
+    struct power_module *power = ctx;
+
+    power->setInteractive(power, i & 1);
+}
+
+static void bench_interaction(void *ctx, int i)
+{
+    struct power_module *power = ctx;
+
+    power->powerHint(power, POWER_HINT_INTERACTION, NULL);
+}
+
+static void bench_vsync(void *ctx, int i)
+{
+    struct power_module *power = ctx;
+
+    power->powerHint(power, POWER_HINT_VSYNC, (void *) (intptr_t) (i & 1));
+}
+
+static void bench_launch(void *ctx, int i)
+{
+    struct power_module *power = ctx;
+
+    power->powerHint(power, POWER_HINT_LAUNCH, (void *) (intptr_t) !(i & 1));
+}
+
+static void bench_low_power(void *ctx, int i)
+{
+    struct power_module *power = ctx;
+
+    power->powerHint(power, POWER_HINT_LOW_POWER, (void *) (intptr_t) (i & 1));
+}
+
+static void bench_set_light(void *ctx, int i)
+{
+    struct light_device_t *light = ctx;
+    struct light_state_t state;
+    unsigned int level = i & 0xff;
+
+    memset(&state, 0, sizeof(state));
+    state.color = 0xff000000 | (level << 16) | (level << 8) | level;
+    light->set_light(light, &state);
+}
+
+static void *load_module(const char *path)
+{
+    void *handle = dlopen(path, RTLD_NOW);
+
+    if (!handle) {
+        fprintf(stderr, "failed to load %s: %s\n", path, dlerror());
+        return NULL;
+    }
+
+    return dlsym(handle, HAL_MODULE_INFO_SYM_AS_STR);
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-n calls] [-p power.so] [-l lights.so]\n", argv0);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *power_lib = DEFAULT_POWER_LIB;
+    const char *lights_lib = DEFAULT_LIGHTS_LIB;
+    struct power_module *power;
+    struct hw_module_t *lights;
+    struct hw_device_t *light_dev = NULL;
+    struct syscounts before, after;
+    char root[256];
+    int64_t *samples;
+    int64_t start;
+    int calls = DEFAULT_CALLS;
+    int opt, ret;
+
+    while ((opt = getopt(argc, argv, "n:p:l:")) != -1) {
+        switch (opt) {
+            case 'n':
+                calls = atoi(optarg);
+                break;
+            case 'p':
+                power_lib = optarg;
+                break;
+            case 'l':
+                lights_lib = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (calls <= 0)
+        usage(argv[0]);
+
+    samples = calloc(calls, sizeof(*samples));
+    if (!samples)
+        return 1;
+
+    ret = fakesysfs_create(root, sizeof(root));
+    if (ret) {
+        fprintf(stderr, "failed to create fake sysfs: %s\n", strerror(-ret));
+        return 1;
+    }
+    setenv("MACALLAN_SYSFS_ROOT", root, 1);
+
+    power = load_module(power_lib);
+    lights = load_module(lights_lib);
+    if (!power || !lights) {
+        fakesysfs_destroy(root);
+        return 1;
+    }
+
+    printf("fake sysfs at %s, %d calls per entry point\n\n", root, calls);
+    printf("%-22s %7s %9s %9s %9s %9s %8s %8s %8s %8s\n", "entry point", "calls",
+            "p50 us", "p90 us", "p99 us", "max us", "open", "close", "read", "write");
+
+    sample_syscounts(&before);
+    start = now_ns();
+    power->init(power);
+    samples[0] = now_ns() - start;
+    usleep(SETTLE_US);
+    sample_syscounts(&after);
+    report("init", samples, 1, &before, &after);
+
+    run("setInteractive", bench_set_interactive, power, samples, calls);
+    run("hint INTERACTION", bench_interaction, power, samples, calls);
+    run("hint VSYNC", bench_vsync, power, samples, calls);
+    run("hint LAUNCH", bench_launch, power, samples, calls);
+    run("hint LOW_POWER", bench_low_power, power, samples, calls);
+
+    if (lights->methods->open(lights, LIGHT_ID_BACKLIGHT, &light_dev) == 0) {
+        run("set_light backlight", bench_set_light, light_dev, samples, calls);
+        light_dev->close(light_dev);
+    } else {
+        fprintf(stderr, "failed to open backlight device\n");
+    }
+
+    fakesysfs_destroy(root);
+    free(samples);
+    return 0;
+}
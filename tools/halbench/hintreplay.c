@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2026 FG6Q-Dev
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays a power hint trace recorded by the power HAL (see power/trace.h)
+ * against the fake sysfs tree or, with -L, the live device. A different
+ * tunables file can be given to compare governor settings on the same
+ * session. Calls are issued at their recorded times, scaled by -s; -s 0
+ * issues them back to back.
+ *
+ * usage: hintreplay [-L] [-p power.so] [-t tunables.conf] [-s speed] trace.bin
+ */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <hardware/hardware.h>
+#include <hardware/power.h>
+
+#include "fakesysfs.h"
+#include "trace.h"
+
+#define DEFAULT_POWER_LIB "power.macallan_host.so"
+#define TIME_IN_STATE_PATH "/sys/devices/system/cpu/cpu0/cpufreq/stats/time_in_state"
+#define MAX_SPEEDS 32
+
+#define NSEC_PER_SEC 1000000000LL
+
+/* Per call type latency, indexed by trace_entry.call when small enough. */
+#define CALL_TYPES 32
+
+struct call_stats {
+    unsigned int count;
+    int64_t total_ns;
+    int64_t max_ns;
+};
+
+struct residency {
+    int n;
+    long khz[MAX_SPEEDS];
+    unsigned long long ticks[MAX_SPEEDS];
+};
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void sleep_until(int64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ns / NSEC_PER_SEC;
+    ts.tv_nsec = ns % NSEC_PER_SEC;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+static const char *call_name(uint32_t call)
+{
+    static char buf[32];
+
+    switch (call) {
+        case TRACE_SET_INTERACTIVE:
+            return "setInteractive";
+        case POWER_HINT_VSYNC:
+            return "hint VSYNC";
+        case POWER_HINT_INTERACTION:
+            return "hint INTERACTION";
+        case POWER_HINT_VIDEO_ENCODE:
+            return "hint VIDEO_ENCODE";
+        case POWER_HINT_VIDEO_DECODE:
+            return "hint VIDEO_DECODE";
+        case POWER_HINT_LOW_POWER:
+            return "hint LOW_POWER";
+        case POWER_HINT_SUSTAINED_PERFORMANCE:
+            return "hint SUSTAINED_PERFORMANCE";
+        case POWER_HINT_LAUNCH:
+            return "hint LAUNCH";
+        case POWER_HINT_SET_PROFILE:
+            return "hint SET_PROFILE";
+        default:
+            snprintf(buf, sizeof(buf), "hint 0x%x", call);
+            return buf;
+    }
+}
+
+static struct trace_entry *load_trace(const char *path, uint32_t *count)
+{
+    struct trace_header header;
+    struct trace_entry *entries;
+    FILE *f = fopen(path, "rb");
+
+    if (!f) {
+        fprintf(stderr, "failed to open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != TRACE_MAGIC ||
+            header.version != TRACE_VERSION) {
+        fprintf(stderr, "%s is not a version %d power hint trace\n", path, TRACE_VERSION);
+        fclose(f);
+        return NULL;
+    }
+
+    entries = calloc(header.count ? header.count : 1, sizeof(*entries));
+    if (!entries || fread(entries, sizeof(*entries), header.count, f) != header.count) {
+        fprintf(stderr, "%s is truncated\n", path);
+        free(entries);
+        fclose(f);
+        return NULL;
+    }
+
+    fclose(f);
+    *count = header.count;
+    return entries;
+}
+
+static void read_residency(const char *root, struct residency *r)
+{
+    char path[512];
+    FILE *f;
+
+    r->n = 0;
+    snprintf(path, sizeof(path), "%s%s", root, TIME_IN_STATE_PATH);
+    f = fopen(path, "r");
+    if (!f)
+        return;
+    while (r->n < MAX_SPEEDS && fscanf(f, "%ld %llu", &r->khz[r->n], &r->ticks[r->n]) == 2)
+        r->n++;
+    fclose(f);
+}
+
+static void report_residency(const struct residency *before, const struct residency *after)
+{
+    long tick_ms = 1000 / sysconf(_SC_CLK_TCK);
+    int i;
+
+    if (!after->n || after->n != before->n)
+        return;
+
+    printf("\n%-10s %10s\n", "kHz", "ms");
+    for (i = 0; i < after->n; i++)
+        printf("%-10ld %10llu\n", after->khz[i],
+                (after->ticks[i] - before->ticks[i]) * tick_ms);
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-L] [-p power.so] [-t tunables.conf] [-s speed] trace.bin\n",
+            argv0);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *power_lib = DEFAULT_POWER_LIB;
+    const char *tunables = NULL;
+    struct call_stats stats[CALL_TYPES];
+    struct residency before, after;
+    struct trace_entry *entries;
+    struct power_module *power;
+    void *handle;
+    char root[256] = "";
+    int64_t start, t0, elapsed;
+    double speed = 1.0;
+    uint32_t count, i, type;
+    int32_t value;
+    int live = 0;
+    int opt, ret;
+
+    while ((opt = getopt(argc, argv, "Lp:t:s:")) != -1) {
+        switch (opt) {
+            case 'L':
+                live = 1;
+                break;
+            case 'p':
+                power_lib = optarg;
+                break;
+            case 't':
+                tunables = optarg;
+                break;
+            case 's':
+                speed = atof(optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (optind != argc - 1 || speed < 0)
+        usage(argv[0]);
+
+    entries = load_trace(argv[optind], &count);
+    if (!entries)
+        return 1;
+
+    if (!live) {
+        ret = fakesysfs_create(root, sizeof(root));
+        if (ret) {
+            fprintf(stderr, "failed to create fake sysfs: %s\n", strerror(-ret));
+            return 1;
+        }
+        setenv("MACALLAN_SYSFS_ROOT", root, 1);
+    }
+    if (tunables)
+        setenv("MACALLAN_TUNABLES", tunables, 1);
+
+    handle = dlopen(power_lib, RTLD_NOW);
+    power = handle ? dlsym(handle, HAL_MODULE_INFO_SYM_AS_STR) : NULL;
+    if (!power) {
+        fprintf(stderr, "failed to load %s: %s\n", power_lib, dlerror());
+        if (!live)
+            fakesysfs_destroy(root);
+        return 1;
+    }
+
+    printf("replaying %u calls from %s against %s\n", count, argv[optind],
+            live ? "the live device" : root);
+
+    memset(stats, 0, sizeof(stats));
+    read_residency(root, &before);
+    power->init(power);
+
+    start = now_ns();
+    t0 = count ? entries[0].time_ns : 0;
+    for (i = 0; i < count; i++) {
+        if (speed > 0)
+            sleep_until(start + (int64_t) ((entries[i].time_ns - t0) / speed));
+
+        value = entries[i].value;
+        elapsed = now_ns();
+        if (entries[i].call == TRACE_SET_INTERACTIVE)
+            power->setInteractive(power, value);
+        else if (entries[i].call == POWER_HINT_SET_PROFILE)
+            power->powerHint(power, POWER_HINT_SET_PROFILE, &value);
+        else
+            power->powerHint(power, entries[i].call, value ? (void *) (intptr_t) 1 : NULL);
+        elapsed = now_ns() - elapsed;
+
+        /* SET_PROFILE and other vendor hints share the last slot. */
+        type = entries[i].call < CALL_TYPES ? entries[i].call : CALL_TYPES - 1;
+        stats[type].count++;
+        stats[type].total_ns += elapsed;
+        if (elapsed > stats[type].max_ns)
+            stats[type].max_ns = elapsed;
+    }
+
+    printf("replayed in %.3f s\n\n", (now_ns() - start) / (double) NSEC_PER_SEC);
+    printf("%-28s %7s %9s %9s\n", "call", "calls", "avg us", "max us");
+    for (type = 0; type < CALL_TYPES; type++) {
+        if (!stats[type].count)
+            continue;
+        printf("%-28s %7u %9.2f %9.2f\n",
+                type == CALL_TYPES - 1 ? "other hints" : call_name(type),
+                stats[type].count, stats[type].total_ns / 1000.0 / stats[type].count,
+                stats[type].max_ns / 1000.0);
+    }
+
+    read_residency(root, &after);
+    report_residency(&before, &after);
+
+    if (!live)
+        fakesysfs_destroy(root);
+    free(entries);
+    return 0;
+}